@@ -0,0 +1,59 @@
+/******************************************************************************
+ * Arena.hpp                                                                  *
+ *                                                                            *
+ * An arena of objects of a single type. Objects are constructed in place in  *
+ * blocks of ARENA_BLOCK_SIZE, so making thousands of them takes a handful of *
+ * allocations rather than thousands, and all of them are destroyed together  *
+ * when the arena is (or when it is cleared), in the reverse of the order     *
+ * they were made. Nothing made by an arena is ever deleted by anybody else,  *
+ * which puts an end to the question of who owns what.                        *
+ *                                                                            *
+ * An object that is finished with early can be recycled: its slot goes on a *
+ * free list and is reused by the next make(). Arenas are not thread safe.    *
+ ******************************************************************************/
+
+#ifndef ARENA
+#define ARENA
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// how many objects each block of an arena holds
+#define ARENA_BLOCK_SIZE 1024
+
+template<class T>
+class Arena{
+public:
+    Arena();
+   ~Arena();
+
+    // constructs a T from args in the arena
+    template<class... Args>
+    T* make(Args&&... args);
+
+    // hands object's slot back to be reused. The object itself is destroyed when the
+    // slot is reused, or along with the arena
+    void recycle(T* object);
+
+    // destroys every object, keeping the first block for reuse
+    void clear();
+
+    // how many objects are in the arena, not counting those recycled
+    size_t size();
+
+private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type Slot;
+
+    std::vector<Slot*> blocks;
+    // how many slots of the last block are in use
+    size_t used;
+    std::vector<T*> freed;
+};
+
+#include "Arena.tpp"
+
+#endif
@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Arena.tpp                                                                  *
+ *                                                                            *
+ * An arena of objects of a single type, allocated ARENA_BLOCK_SIZE at a time *
+ * and destroyed all at once.                                                 *
+ ******************************************************************************/
+
+#include <new>
+#include <utility>
+
+template<class T>
+Arena<T>::Arena(){
+    used = ARENA_BLOCK_SIZE;
+}
+
+template<class T>
+Arena<T>::~Arena(){
+    clear();
+    for(Slot* block : blocks)
+        delete[] block;
+}
+
+template<class T>
+template<class... Args>
+T* Arena<T>::make(Args&&... args){
+    if(!freed.empty()){
+        T* object = freed.back();
+        freed.pop_back();
+        object->~T();
+        return new (object) T(std::forward<Args>(args)...);
+    }
+    if(used == ARENA_BLOCK_SIZE){
+        blocks.push_back(new Slot[ARENA_BLOCK_SIZE]);
+        used = 0;
+    }
+    return new (&blocks.back()[used++]) T(std::forward<Args>(args)...);
+}
+
+template<class T>
+void Arena<T>::recycle(T* object){
+    freed.push_back(object);
+}
+
+// Recycled objects are still constructed (just waiting to be reused), so every slot
+// handed out is destroyed here
+template<class T>
+void Arena<T>::clear(){
+    for(size_t b=blocks.size();b>0;b--){
+        size_t n = b == blocks.size() ? used : ARENA_BLOCK_SIZE;
+        for(size_t i=n;i>0;i--)
+            reinterpret_cast<T*>(&blocks[b - 1][i - 1])->~T();
+    }
+    for(size_t b=1;b<blocks.size();b++)
+        delete[] blocks[b];
+    if(blocks.size() > 1)
+        blocks.resize(1);
+    used = blocks.empty() ? ARENA_BLOCK_SIZE : 0;
+    freed.clear();
+}
+
+template<class T>
+size_t Arena<T>::size(){
+    if(blocks.empty())
+        return 0;
+    return (blocks.size() - 1)*ARENA_BLOCK_SIZE + used - freed.size();
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * BoundedQueue.hpp                                                           *
+ *                                                                            *
+ * A fixed size, lock free queue for handing work between the stages of the  *
+ * crime pipeline. It is Dmitry Vyukov's bounded queue: a ring of cells, each *
+ * with a sequence number saying whether it is ready to be written or read,   *
+ * so any number of threads can push and pop without ever taking a lock. (The *
+ * pipeline only ever has one producer or one consumer on each queue, but the *
+ * same queue does for both.)                                                 *
+ *                                                                            *
+ * push() and pop() wait (yielding the processor) while the queue is full or  *
+ * empty. Every such wait is counted as a stall, and the depth of the queue   *
+ * is sampled on each push, so it is easy to see which stage is holding the   *
+ * rest up: a queue that is always full is feeding a slow stage, and a queue  *
+ * that is always empty is being fed by one.                                  *
+ ******************************************************************************/
+
+#ifndef BOUNDED_QUEUE
+#define BOUNDED_QUEUE
+
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+
+template<class T>
+class BoundedQueue{
+public:
+    // capacity is rounded up to a power of two
+    BoundedQueue(size_t capacity, const char* name);
+   ~BoundedQueue();
+
+    // these return false rather than waiting
+    bool tryPush(const T& value);
+    bool tryPop(T& value);
+
+    // waits for room, then pushes
+    void push(const T& value);
+    // waits for something to pop, returning false once the queue has been closed and
+    // everything in it popped
+    bool pop(T& value);
+
+    // says nothing more will be pushed
+    void close();
+
+    // how many values are waiting (only approximate while other threads are busy)
+    size_t depth();
+    size_t capacity();
+
+    // prints the name, capacity, traffic, stalls and depths of the queue
+    void printStats(std::ostream& out);
+
+    const char* name;
+    std::atomic<unsigned long long> pushes, pushStalls, popStalls, depthTotal;
+    std::atomic<size_t> peakDepth;
+
+private:
+    BoundedQueue(const BoundedQueue&);
+    BoundedQueue& operator=(const BoundedQueue&);
+
+    struct Cell{
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell* cells;
+    size_t mask;
+    std::atomic<bool> closed;
+    // kept on cache lines of their own, as the producers and consumers hammer them
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+};
+
+#include "BoundedQueue.tpp"
+
+#endif
@@ -0,0 +1,133 @@
+/******************************************************************************
+ * BoundedQueue.tpp                                                           *
+ *                                                                            *
+ * A fixed size, lock free queue for handing work between the stages of the  *
+ * crime pipeline, after Dmitry Vyukov's bounded MPMC queue.                  *
+ ******************************************************************************/
+
+#include <thread>
+
+template<class T>
+BoundedQueue<T>::BoundedQueue(size_t capacity, const char* name)
+    : name(name), pushes(0), pushStalls(0), popStalls(0), depthTotal(0), peakDepth(0),
+      closed(false), enqueuePos(0), dequeuePos(0){
+    size_t size = 2;
+    while(size < capacity)
+        size *= 2;
+    cells = new Cell[size];
+    mask = size - 1;
+    // a cell is ready to be pushed into when its sequence equals the position
+    for(size_t i=0;i<size;i++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template<class T>
+BoundedQueue<T>::~BoundedQueue(){
+    delete[] cells;
+}
+
+template<class T>
+bool BoundedQueue<T>::tryPush(const T& value){
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while(true){
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        long long diff = (long long)sequence - (long long)pos;
+        if(diff == 0){
+            if(enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }else if(diff < 0){
+            // the cell hasn't been popped since the last time round: full
+            return false;
+        }else{
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->value = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    size_t d = depth();
+    pushes.fetch_add(1, std::memory_order_relaxed);
+    depthTotal.fetch_add(d, std::memory_order_relaxed);
+    size_t peak = peakDepth.load(std::memory_order_relaxed);
+    while(d > peak && !peakDepth.compare_exchange_weak(peak, d, std::memory_order_relaxed))
+        ;
+    return true;
+}
+
+template<class T>
+bool BoundedQueue<T>::tryPop(T& value){
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while(true){
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        long long diff = (long long)sequence - (long long)(pos + 1);
+        if(diff == 0){
+            if(dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }else if(diff < 0){
+            // nothing has been pushed into the cell yet: empty
+            return false;
+        }else{
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    value = cell->value;
+    // ready to be pushed into again, one lap later
+    cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    return true;
+}
+
+template<class T>
+void BoundedQueue<T>::push(const T& value){
+    if(tryPush(value))
+        return;
+    pushStalls.fetch_add(1, std::memory_order_relaxed);
+    while(!tryPush(value))
+        std::this_thread::yield();
+}
+
+template<class T>
+bool BoundedQueue<T>::pop(T& value){
+    if(tryPop(value))
+        return true;
+    popStalls.fetch_add(1, std::memory_order_relaxed);
+    while(true){
+        // check closed before trying, so nothing pushed just before closing is missed
+        bool wasClosed = closed.load(std::memory_order_acquire);
+        if(tryPop(value))
+            return true;
+        if(wasClosed)
+            return false;
+        std::this_thread::yield();
+    }
+}
+
+template<class T>
+void BoundedQueue<T>::close(){
+    closed.store(true, std::memory_order_release);
+}
+
+template<class T>
+size_t BoundedQueue<T>::depth(){
+    size_t in  = enqueuePos.load(std::memory_order_relaxed);
+    size_t out = dequeuePos.load(std::memory_order_relaxed);
+    return in > out ? in - out : 0;
+}
+
+template<class T>
+size_t BoundedQueue<T>::capacity(){
+    return mask + 1;
+}
+
+template<class T>
+void BoundedQueue<T>::printStats(std::ostream& out){
+    unsigned long long n = pushes.load();
+    out << name << ": capacity " << capacity() << ", " << n << " pushed, "
+        << "average depth " << (n ? (double)depthTotal.load()/n : 0.0)
+        << ", peak depth " << peakDepth.load() << ", "
+        << pushStalls.load() << " stalled pushes (full), "
+        << popStalls.load() << " stalled pops (empty)\n";
+}
@@ -0,0 +1,208 @@
+/******************************************************************************
+ * CostSweep.cpp                                                              *
+ *                                                                            *
+ * Every restauraunt's crime cost under a lot of cost files at once.          *
+ ******************************************************************************/
+
+#include "CostSweep.h"
+
+#include <cctype>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+CostSweep::CostSweep(){
+    recencyEnd = halfLifeEnd = 0;
+}
+
+// a "sweep SETTING FROM TO STEPS" line
+struct SweepRange{
+    string setting;
+    double from, to;
+    int steps;
+};
+
+bool CostSweep::load(const char* path, const CostModel& base){
+    ifstream in(path);
+    if(!in)
+        return false;
+    vector<SweepRange> ranges;
+    string line;
+    int lineNumber = 0;
+    while(getline(in, line)){
+        lineNumber++;
+        size_t hash = line.find('#');
+        if(hash != string::npos)
+            line.erase(hash);
+        istringstream words(line);
+        string key;
+        if(!(words >> key))
+            continue;
+        bool ok = true;
+        if(key == "set"){
+            string name;
+            ok = (bool)(words >> ws) && (bool)getline(words, name);
+            if(ok){
+                while(!name.empty() && isspace((unsigned char)name[name.size() - 1]))
+                    name.erase(name.size() - 1);
+                models.push_back(base);
+                names.push_back(name);
+            }
+        }else if(key == "sweep"){
+            SweepRange range;
+            ok = (bool)(words >> range.setting >> range.from >> range.to >> range.steps) &&
+                 range.steps > 0;
+            // and check the setting is one a cost file could have
+            CostModel check(base);
+            ok = ok && check.set(range.setting + " 0");
+            if(ok)
+                ranges.push_back(range);
+        }else{
+            // settings only mean anything once a set has been started
+            ok = !models.empty() && models.back().set(line);
+        }
+        if(!ok)
+            cerr << path << ":" << lineNumber << ": didn't understand \"" << line << "\"\n";
+    }
+
+    // Every combination of the ranges, the first changing slowest
+    if(!ranges.empty()){
+        size_t combinations = 1;
+        for(const SweepRange& range : ranges)
+            combinations *= range.steps;
+        for(size_t c=0;c<combinations;c++){
+            CostModel model(base);
+            vector<string> settings(ranges.size());
+            size_t rest = c;
+            for(size_t i=ranges.size();i-- > 0;){
+                const SweepRange& range = ranges[i];
+                int step = (int)(rest % range.steps);
+                rest /= range.steps;
+                double value = range.steps == 1 ? range.from :
+                               range.from + (range.to - range.from)*step/(range.steps - 1);
+                ostringstream setting;
+                setting << range.setting << ' ' << value;
+                model.set(setting.str());
+                settings[i] = setting.str();
+            }
+            // named for the values, like "firearm=3 recency.scale=50"
+            string name;
+            for(size_t i=0;i<settings.size();i++){
+                settings[i][ranges[i].setting.size()] = '=';
+                name += (i ? " " : "") + settings[i];
+            }
+            models.push_back(model);
+            names.push_back(name);
+        }
+    }
+    return true;
+}
+
+void CostSweep::update(const TypeDictionary& types){
+    for(CostModel& model : models)
+        model.update(types);
+    layOut();
+    size_t n = size();
+    size_t typeCount = types.size() < MAX_INCIDENT_TYPES ? types.size() : MAX_INCIDENT_TYPES;
+    costs.assign(typeCount*WEAPON_KINDS*n, 0);
+    for(size_t type=0;type<typeCount;type++)
+        for(int weapon=0;weapon<WEAPON_KINDS;weapon++)
+            for(size_t k=0;k<n;k++)
+                costs[(type*WEAPON_KINDS + weapon)*n + k] =
+                    models[order[k]].initialCost((unsigned char)type, (unsigned char)weapon);
+}
+
+// Sorts the sets by decay policy, and pulls out their settings
+void CostSweep::layOut(){
+    order.clear();
+    DecayKind kinds[3] = {DECAY_RECENCY, DECAY_HALF_LIFE, DECAY_NONE};
+    for(int i=0;i<3;i++){
+        for(size_t set=0;set<size();set++)
+            if(models[set].decay == kinds[i])
+                order.push_back(set);
+        if(kinds[i] == DECAY_RECENCY)
+            recencyEnd = order.size();
+        else if(kinds[i] == DECAY_HALF_LIFE)
+            halfLifeEnd = order.size();
+    }
+    size_t n = size();
+    boost.resize(n);
+    scale.resize(n);
+    period.resize(n);
+    halfLife.resize(n);
+    before.resize(n);
+    for(size_t k=0;k<n;k++){
+        const CostModel& model = models[order[k]];
+        boost[k]    = model.recency.boost;
+        scale[k]    = model.recency.scale;
+        period[k]   = model.recency.period;
+        halfLife[k] = model.halfLife.halfLife;
+        before[k]   = model.halfLife.before;
+    }
+}
+
+// These work out exactly what RecencyDecay, HalfLifeDecay and NoDecay's cost()s do, the
+// same way, so a set comes out exactly as it would on a run of its own, but a whole run
+// of sets at a time
+void CostSweep::score(const CrimeLinks& links, const CrimeTable& table, size_t r, int opened,
+                      int today, double* scores) const{
+    size_t n = size();
+    double* __restrict__ out = scores;
+    const double* __restrict__ boosts = boost.data();
+    const double* __restrict__ scales = scale.data();
+    const double* __restrict__ periods = period.data();
+    const double* __restrict__ halfLives = halfLife.data();
+    const double* __restrict__ befores = before.data();
+    for(size_t k=0;k<n;k++)
+        out[k] = 0;
+    links.forEach(r, [&](unsigned crime){
+        // every set's initial cost for the crime's type and weapon
+        size_t kind = table.types[crime]*WEAPON_KINDS + (table.weapons[crime] & (WEAPON_KINDS - 1));
+        const double* __restrict__ c = &costs[kind*n];
+        int day = table.days[crime];
+        // left out, as score() leaves them out
+        if(day == INVALID_DAY)
+            return;
+        // and crimes after today count as today's, as they do in RecencyDecay
+        int age = max(today - day, 0);
+        if(opened < day){
+            for(size_t k=0;k<recencyEnd;k++)
+                out[k] += c[k]*(boosts[k]/(1 + age/scales[k]) + 1);
+        }else{
+            double sinceOpened = (opened - day) + 1.0;
+            for(size_t k=0;k<recencyEnd;k++)
+                out[k] += c[k]/ceil(sinceOpened/periods[k]);
+        }
+        bool beforeOpening = day < opened;
+        for(size_t k=recencyEnd;k<halfLifeEnd;k++)
+            out[k] += c[k]*exp2(-age/halfLives[k])*(beforeOpening ? befores[k] : 1);
+        for(size_t k=halfLifeEnd;k<n;k++)
+            out[k] += c[k];
+    });
+}
+
+void CostSweep::write(ostream& out, const vector<Restauraunt*>& restauraunts,
+                      const vector<double>& scores) const{
+    size_t n = size();
+    // where each set (in file order) was laid out
+    vector<size_t> position(n);
+    for(size_t k=0;k<n;k++)
+        position[order[k]] = k;
+    out << "Name, Address";
+    for(size_t set=0;set<n;set++){
+        out << ", ";
+        Restauraunt::writeQuoted(out, names[set].c_str());
+    }
+    out << '\n';
+    for(size_t i=0;i<restauraunts.size();i++){
+        restauraunts[i]->writeKey(out);
+        const double* row = &scores[i*n];
+        for(size_t set=0;set<n;set++)
+            out << ", " << llround(row[position[set]]);
+        out << '\n';
+    }
+}
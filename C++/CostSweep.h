@@ -0,0 +1,81 @@
+/******************************************************************************
+ * CostSweep.h                                                                *
+ *                                                                            *
+ * A lot of cost files at once. Trying out new weights used to mean running   *
+ * the whole analysis again for every one of them, even though the crimes and *
+ * which restauraunts they are near never change; only the costs do. A sweep  *
+ * takes any number of sets of settings and works out every restauraunt's     *
+ * crime cost under all of them in one go over the CrimeLinks, giving a       *
+ * matrix of scores (a row per restauraunt, a column per set).                *
+ *                                                                            *
+ * The sweep file is made up of sets, each starting with "set NAME" and      *
+ * followed by the lines of a cost file that it changes from the base one.    *
+ * Or, for a grid of settings, lines "sweep SETTING FROM TO STEPS" make a set *
+ * for every combination of STEPS evenly spaced values of each SETTING.       *
+ *                                                                            *
+ * The sets are laid out side by side: the initial costs of every set for a   *
+ * type and weapon are next to each other, as are the settings of each decay *
+ * policy, with the sets sorted by policy. So each crime is a few straight    *
+ * loops across the sets, which the compiler can vectorize.                   *
+ *                                                                            *
+ * A set can only reweigh the crimes the base cost file counts: crimes that   *
+ * cost nothing there (or are left out with -x) aren't linked to anything.    *
+ ******************************************************************************/
+
+#ifndef COST_SWEEP
+#define COST_SWEEP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Crime.h"
+#include "CrimeLinks.h"
+#include "CrimeTable.h"
+#include "Restauraunt.h"
+#include "TypeDictionary.h"
+
+class CostSweep{
+public:
+    CostSweep();
+
+    // reads the sets in the sweep file at path, each starting from base, returning
+    // false if the file couldn't be read. Lines that don't make sense are reported
+    bool load(const char* path, const CostModel& base);
+
+    // the number of sets, and the name of each (in the order of the file)
+    size_t size() const { return models.size(); }
+    const std::string& name(size_t set) const { return names[set]; }
+
+    // lays out the costs of every set for the types numbered so far
+    void update(const TypeDictionary& types);
+
+    // Adds up the cost of every crime linked to restauraunt r (opened on the day
+    // opened) under each set, into scores[0] up to scores[size() - 1]. The scores are
+    // in the order the sets are laid out in, which write() puts back in file order,
+    // and aren't rounded until they are written, just as a run of one set would do
+    void score(const CrimeLinks& links, const CrimeTable& table, size_t r, int opened,
+               int today, double* scores) const;
+
+    // writes out the score matrix (size() scores for each restauraunt, as score() left
+    // them) as a CSV
+    void write(std::ostream& out, const std::vector<Restauraunt*>& restauraunts,
+               const std::vector<double>& scores) const;
+
+private:
+    void layOut();
+
+    std::vector<CostModel> models;
+    std::vector<std::string> names;
+    // the sets in the order they are laid out in (those with recency decay, then half
+    // life, then none), and where each of those runs ends
+    std::vector<size_t> order;
+    size_t recencyEnd, halfLifeEnd;
+    // the initial cost of each type and weapon under each set,
+    // costs[(type*WEAPON_KINDS + weapon)*size() + set]
+    std::vector<double> costs;
+    // the decay settings, by set (only those of the sets using the policy mean anything)
+    std::vector<double> boost, scale, period, halfLife, before;
+};
+
+#endif
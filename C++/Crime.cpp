@@ -1,56 +1,110 @@
 #include "Crime.h"
 
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
 using namespace std;
 
-// initialCrimeCost is determined per crime and is a rough heuristic of the danger of the crime,
-// 0 being safe and higher numbers being more dangerous
-int initialCrimeCost(const struct Crime& c){
-    // c.type represents the crime type in integer form, but this depends on what file
-    // is read in, as the integer is merely the order in which an incident showed up in
-    // In my Crime CSV, MedAssist showed up 10th, and I want to ignore MedAssist, so I
-    // used this
-    if(c.type == MED_ASSIST){ // MED_ASSIST is def'd to 10
-        return 0;
+CostModel::CostModel(){
+    decay = DECAY_RECENCY;
+    // The constants SHOOTING_COST, WEAPON_COST, and FIREARM_COST are 5, 2, and 3
+    // respectively, are defined in Crime.h, and are significant in calculation of the
+    // "Danger" of a crime
+    weaponCosts[0] = 1;           // unarmed
+    weaponCosts[1] = WEAPON_COST; // Other
+    weaponCosts[2] = WEAPON_COST; // Knife
+    weaponCosts[3] = FIREARM_COST;
+    shootingCost = SHOOTING_COST;
+    filled = 0;
+    for(size_t i=0;i<MAX_INCIDENT_TYPES*WEAPON_KINDS;i++)
+        table[i] = 0;
+}
+
+// The cost file is a setting per line, a name followed by its value; anything after a
+// '#' is a comment
+bool CostModel::load(const char* path){
+    ifstream in(path);
+    if(!in)
+        return false;
+    string line;
+    int lineNumber = 0;
+    while(getline(in, line)){
+        lineNumber++;
+        if(!set(line))
+            cerr << path << ":" << lineNumber << ": didn't understand \"" << line << "\"\n";
     }
-    
-    // Otherwise, the initial cost is determined by whether there was a shooting and
-    // the weapons involved
-    
-    // The constants SHOOTING_COST, WEAPON_COST, and FIREARM_COST are 5, 2, and 3 respectively,
-    // are defined in Crime.h, and are significant in calculation of the "Danger" of a crime
-    int cost = 1;
-    if(c.weapon & SHOOTING_FLAG){
-        cost*=SHOOTING_COST;
+    return true;
+}
+
+bool CostModel::set(string line){
+    size_t hash = line.find('#');
+    if(hash != string::npos)
+        line.erase(hash);
+    istringstream words(line);
+    string key;
+    if(!(words >> key))
+        return true;
+    // Anything already in the table was worked out with the old settings
+    filled = 0;
+    if(key == "decay"){
+        string name;
+        words >> name;
+        if(name == "recency")
+            decay = DECAY_RECENCY;
+        else if(name == "halflife")
+            decay = DECAY_HALF_LIFE;
+        else if(name == "none")
+            decay = DECAY_NONE;
+        else
+            return false;
+        return true;
     }
-    switch(c.weapon & WEAPON_FLAG){
-        case 0://unarmed
-            break;
-        case 1:case 2: // Knife or Other
-            cost*=WEAPON_COST;
-            break;
-        case 3:
-            cost*=FIREARM_COST;
+    if(key == "type"){
+        // type WEIGHT NAME, as the names have spaces in them
+        double weight;
+        string name;
+        if(!(words >> weight) || !(words >> ws) || !getline(words, name))
+            return false;
+        while(!name.empty() && isspace((unsigned char)name[name.size() - 1]))
+            name.erase(name.size() - 1);
+        typeWeights.push_back(make_pair(name, weight));
+        return true;
     }
-    return cost;
+    double* setting = NULL;
+    if(key == "unarmed")              setting = &weaponCosts[0];
+    else if(key == "other")           setting = &weaponCosts[1];
+    else if(key == "knife")           setting = &weaponCosts[2];
+    else if(key == "firearm")         setting = &weaponCosts[3];
+    else if(key == "shooting")        setting = &shootingCost;
+    else if(key == "recency.boost")   setting = &recency.boost;
+    else if(key == "recency.scale")   setting = &recency.scale;
+    else if(key == "recency.period")  setting = &recency.period;
+    else if(key == "halflife.days")   setting = &halfLife.halfLife;
+    else if(key == "halflife.before") setting = &halfLife.before;
+    // (read into value first, as a failed read would zero the setting)
+    double value;
+    if(!setting || !(words >> value))
+        return false;
+    *setting = value;
+    return true;
 }
 
-// finalCrimeCost is determined by both a crime and a restauraunt. It could potentially use how
-// close the crime was to the restauraunt, but I decided to ignore that as all crimes
-// I look at occur within 100 meters of the restauraunt in question.
-// Instead, it uses the initial crime cost and a rough heuristic counting more
-// recent crimes as higher and crimes that occured before the restauraunt was established
-// as lower.
-int finalCrimeCost(const Date& crimeDate, const Date& establishmentDate, const Date& now,
-                   const Location& crimeLoc, const Location& establishmentLoc,
-                   int initialCost
-                  ){
-    if(initialCost == 0)
-        return 0;
-    if(establishmentDate < crimeDate){
-        int daysSinceCrime = now - establishmentDate;
-        initialCost = (int)(initialCost*(2/(1 + daysSinceCrime/50.0) + 1));
-        // No space penalty for now
-        return initialCost;
+// Every combination is worked out ahead of time, so that the cost of a crime is a
+// single lookup rather than a chain of branches over the flags
+void CostModel::update(const TypeDictionary& types){
+    size_t n = types.size() < MAX_INCIDENT_TYPES ? types.size() : MAX_INCIDENT_TYPES;
+    for(;filled<n;filled++){
+        unsigned char type = (unsigned char)filled;
+        double weight = types.excluded(type) ? 0 : 1;
+        for(const pair<string, double>& typeWeight : typeWeights)
+            if(typeWeight.first == types.name(type))
+                weight *= typeWeight.second;
+        for(int weapon=0;weapon<WEAPON_KINDS;weapon++){
+            double cost = weight*weaponCosts[weapon & WEAPON_FLAG];
+            if(weapon & SHOOTING_FLAG)
+                cost *= shootingCost;
+            table[filled*WEAPON_KINDS + weapon] = cost;
+        }
     }
-    return (int)(initialCost/ceil(((establishmentDate - crimeDate)+1.0)/365));
-}
\ No newline at end of file
+}
@@ -3,10 +3,17 @@
 
 #include "Location.h"
 #include "Date.h"
+#include "TypeDictionary.h"
+#include <algorithm>
 #include <cmath>
 
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
 
+// The costs used unless the cost file says otherwise: an unarmed crime costs 1, and the
+// weapon and a shooting each multiply that
 #define SHOOTING_COST 5
 #define FIREARM_COST  3
 #define WEAPON_COST   2
@@ -15,18 +22,104 @@
 #define SHOOTING_FLAG 4
 #define WEAPON_FLAG 3
 
-#define MED_ASSIST 10
+// every combination of weapon and shooting flags
+#define WEAPON_KINDS 8
 
-struct Crime{
-    unsigned char type;
-    unsigned char weapon;
-    Date date;
-    int copies;
+// crimes affect every restauraunt within this many meters of them
+#define CRIME_RADIUS 100
+// the furthest a query or a ring can reach, in meters, which is well past the edges of
+// the city already
+#define MAX_RADIUS 50000
+
+// The crimes themselves are kept in a CrimeTable (see CrimeTable.h), and described by
+// a type number and weapon flags (WEAPON_FLAG bits 0 for unarmed, 1 for other, 2 for
+// a knife and 3 for a firearm, plus SHOOTING_FLAG if there was a shooting)
+
+// The decay policies, which turn the initial cost of a crime into what it costs a
+// restauraunt, given the day of the crime, the day the restauraunt opened, and today
+// (all as Date::epochDay()s). None of them look at how close the crime was, as every
+// crime counted is within CRIME_RADIUS anyway (Rings.h breaks them down by distance).
+// Each is a plain struct with an inline cost(), and the scoring is a template over
+// them, so whichever one is used gets inlined into the scoring loop rather than called
+// through a pointer for every crime. The costs they give are fractions, and are only
+// rounded once every crime near a restauraunt has been added up: a decayed crime often
+// costs less than 1, and rounding each one on its own would make it count for nothing.
+
+// The original heuristic: a crime since the restauraunt opened counts for up to
+// boost + 1 times its cost the more recent it is (falling off over about scale days),
+// and one from before it opened counts for less the longer before it was, divided by
+// the number of periods (years, by default) before. (How recent a crime was used to be
+// measured from the day the restauraunt opened, by mistake, rather than the crime.)
+// A crime dated after today (a typo in the file, usually) counts as happening today,
+// under this and HalfLifeDecay both, rather than for more than any crime could
+struct RecencyDecay{
+    double boost, scale, period;
+
+    RecencyDecay() : boost(2), scale(50), period(365) {}
+    double cost(double initialCost, int crimeDay, int openedDay, int today) const {
+        if(openedDay < crimeDay){
+            int daysSinceCrime = std::max(today - crimeDay, 0);
+            return initialCost*(boost/(1 + daysSinceCrime/scale) + 1);
+        }
+        return initialCost/ceil(((openedDay - crimeDay) + 1.0)/period);
+    }
+};
+
+// A crime counts for half as much every halfLife days, and before times as much again
+// if it happened before the restauraunt opened
+struct HalfLifeDecay{
+    double halfLife, before;
+
+    HalfLifeDecay() : halfLife(365), before(0.5) {}
+    double cost(double initialCost, int crimeDay, int openedDay, int today) const {
+        double weight = exp2(-std::max(today - crimeDay, 0)/halfLife);
+        return initialCost*weight*(crimeDay < openedDay ? before : 1);
+    }
+};
+
+// Every crime counts for its initial cost, however long ago it was
+struct NoDecay{
+    double cost(double initialCost, int, int, int) const { return initialCost; }
+};
+
+enum DecayKind { DECAY_RECENCY, DECAY_HALF_LIFE, DECAY_NONE };
+
+// How much each crime costs, as a table of the initial cost of every type and
+// combination of weapon flags, and which decay policy (and its settings) to use. All of
+// it can be changed without recompiling, through a cost file (see CrimeCosts.cfg in
+// the data folder for what goes in one)
+class CostModel{
+public:
+    CostModel();
+
+    // reads the settings in the cost file at path over the defaults; returns false if
+    // the file couldn't be read. Lines that don't make sense are reported and skipped
+    bool load(const char* path);
+    // applies a single line of a cost file, returning false if it doesn't make sense
+    bool set(std::string line);
+
+    // Fills in the table for any types numbered since the last update. Types the
+    // TypeDictionary excludes cost nothing
+    void update(const TypeDictionary& types);
+
+    // the initial cost of a crime, 0 being safe and higher numbers being more dangerous
+    double initialCost(unsigned char type, unsigned char weapon) const {
+        return table[type*WEAPON_KINDS + (weapon & (WEAPON_KINDS - 1))];
+    }
+
+    DecayKind decay;
+    RecencyDecay recency;
+    HalfLifeDecay halfLife;
+    NoDecay none;
+
+private:
+    // the cost of each weapon (by its WEAPON_FLAG bits), and what a shooting multiplies it by
+    double weaponCosts[WEAPON_FLAG + 1];
+    double shootingCost;
+    // what the costs of crimes of these types (by name) are multiplied by
+    std::vector<std::pair<std::string, double> > typeWeights;
+    double table[MAX_INCIDENT_TYPES*WEAPON_KINDS];
+    size_t filled;
 };
-int initialCrimeCost(const struct Crime& c);
-int finalCrimeCost(const Date& crimeDate, const Date& establishmentDate, const Date& now,
-                   const Location& crimeLoc, const Location& establishmentLoc,
-                   int initalCost
-                  );
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,706 @@
+/******************************************************************************
+ * CrimeIngest.cpp                                                            *
+ *                                                                            *
+ * The crime pass: reading every crime in the (huge) crime file, finding the  *
+ * restauraunts within CRIME_RADIUS of each one, and adding the crime to them,*
+ * spread over as many threads as asked for.                                  *
+ ******************************************************************************/
+
+#include "CrimeIngest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+#include "BoundedQueue.hpp"
+#include "CsvReader.h"
+#include "IncidentSet.h"
+#include "InputFile.h"
+#include "KdTree.hpp"
+
+using namespace std;
+
+CrimeIngest::CrimeIngest(SpatialIndex<Restauraunt>& index, vector<Restauraunt*>& restauraunts,
+                         TypeDictionary& types, CostModel& costs, int threads)
+    : index(index), restauraunts(restauraunts), types(types), costs(costs){
+    this->threads = threads < 1 ? 1 : threads;
+    crimesProcessed = 0;
+    rowsMerged = 0;
+    duplicates = 0;
+    resumedCrimes = 0;
+    resumedChanged = false;
+    bytesRead = resumeAt = 0;
+    cutShort = false;
+    log = &cout;
+    // I realized after a bit that I would want a date representing now to determine how
+    // long ago things happened, but I didn't want too create a new date for every
+    // restauraunt or crime
+    now = Date::now();
+    batches.resize(this->threads);
+    layerBatches.resize(this->threads);
+    layers = NULL;
+}
+
+CrimeIngest::~CrimeIngest(){
+}
+
+void CrimeIngest::addLayers(Layers& layers){
+    this->layers = &layers;
+}
+
+template<class F>
+void CrimeIngest::parallelFor(size_t n, F work){
+    if(threads == 1 || n < 2){
+        for(size_t i=0;i<n;i++)
+            work(i, 0);
+        return;
+    }
+    atomic<size_t> next(0);
+    auto worker = [&](int thread){
+        size_t i;
+        while((i = next.fetch_add(1)) < n)
+            work(i, thread);
+    };
+    vector<thread> pool;
+    for(int t=1;t<threads;t++)
+        pool.push_back(thread(worker, t));
+    worker(0);
+    for(thread& t : pool)
+        t.join();
+}
+
+const char* CrimeIngest::nextRow(const char* p, const char* end){
+    if(p >= end)
+        return end;
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+// Hands out the blocks of the file, less the header, and less anything read by the run
+// resumed from (which always stopped at the end of a block, so at the end of a row)
+bool CrimeIngest::nextBlock(InputFile& file, const char*& begin, const char*& end){
+    while(file.nextBlock(begin, end)){
+        unsigned long long blockStart = bytesRead;
+        bytesRead += end - begin;
+        if(bytesRead <= resumeAt)
+            continue;
+        if(blockStart < resumeAt){
+            begin += resumeAt - blockStart;
+        }else if(blockStart == 0){
+            begin = nextRow(begin, end); // Ignore first line
+            rowsMerged = 1;
+        }
+        return true;
+    }
+    if(bytesRead < resumeAt)
+        cutShort = true;
+    return false;
+}
+
+// The file got shorter after the check in main (or is being rewritten under us), so the
+// crimes resumed from aren't the ones in it any more
+bool CrimeIngest::shortened(){
+    cerr << "The crime file is shorter than it was last time; run without -u to read it "
+         << "all again\n";
+    return false;
+}
+
+bool CrimeIngest::run(const char* path){
+    InputFile file(path);
+    if(!file.isOpen())
+        return false;
+    const char* begin;
+    const char* end;
+    while(nextBlock(file, begin, end)){
+        processBlock(begin, end);
+        *log << crimesProcessed << " crimes processed\n";
+    }
+    if(cutShort)
+        return shortened();
+    *log << duplicates << " rows were more of an incident already read\n";
+    buildLinks();
+    return true;
+}
+
+// Cuts the block into chunks that each start at the start of a row, then parses and
+// joins the chunks in parallel, and finally numbers the incident types and merges
+// everything back in file order.
+void CrimeIngest::processBlock(const char* begin, const char* end){
+    size_t pieces = threads*CHUNKS_PER_THREAD;
+    size_t target = (end - begin)/pieces + 1;
+    vector<CrimeChunk*> chunks;
+    const char* start = begin;
+    while(start < end){
+        const char* stop = start + target < end ? nextRow(start + target, end) : end;
+        CrimeChunk* chunk = new CrimeChunk;
+        chunk->begin = start;
+        chunk->end = stop;
+        chunk->sequence = chunks.size();
+        chunks.push_back(chunk);
+        start = stop;
+    }
+    size_t n = chunks.size();
+
+    parallelFor(n, [&](size_t i, int thread){
+        parse(*chunks[i]);
+        join(*chunks[i], batches[thread], layerBatches[thread]);
+    });
+    for(size_t i=0;i<n;i++){
+        numberTypes(*chunks[i]);
+        merge(*chunks[i]);
+        delete chunks[i];
+    }
+}
+
+/* Data is stored in crime csv as:
+ * COMPNOS,NatureCode,INCIDENT_TYPE_DESCRIPTION,MAIN_CRIMECODE,REPTDISTRICT,
+ * REPORTINGAREA,FROMDATE,WEAPONTYPE,Shooting,DOMESTIC,
+ * SHIFT,Year,Month,DAY_WEEK,UCRPART,
+ * X,Y,STREETNAME,XSTREETNAME,Location
+ *
+ * We want COMPNOS [0], INCIDENT_TYPE_DESCRIPTION [2], FROMDATE [6], WEAPONTYPE [7],
+ * Shooting [8], and Location [19]
+ */
+void CrimeIngest::parse(CrimeChunk& chunk){
+    CsvReader rows(chunk.begin, chunk.end);
+    // m stores metric location, l stores latitude/longitude
+    Location m, l;
+    Date date;
+    unsigned char type, weapon;
+    chunk.rowCount = 0;
+    while(rows.readRow()){
+        unsigned row = chunk.rowCount++;
+        // Rows missing cells would just be misread, so skip them
+        if(rows.size() < 20)
+            continue;
+
+        // INCIDENT_TYPE_DESCRIPTION, numbered in the order it shows up in this chunk
+        // for now (the TypeDictionary is only touched by the thread merging chunks).
+        // Looking it up straight from the Field copies nothing unless it is new here
+        unsigned local = chunk.typeNames.intern(rows[2]);
+        type = (unsigned char)(local < MAX_INCIDENT_TYPES ? local : MAX_INCIDENT_TYPES - 1);
+
+        // FROMDATE
+        date.setDate(rows[6]);
+
+        // WEAPONTYPE (either Unarmed, Other, Knife, or Firearm)
+        weapon = 0;
+        switch(rows[7].empty() ? 'U' : rows[7][0]){
+            case 'O': // Other
+                weapon = 1;
+                break;
+            case 'K': // Knife
+                weapon = 2;
+                break;
+            case 'F': // Firearm
+                weapon = 3;
+                break;
+            default: // Unarmed
+                break;
+        }
+
+        //Shooting (Yes or No)
+        // If there was a shooting, add a shooting flag
+        if(!rows[8].empty() && rows[8][0] == 'Y'){
+            weapon += 4;
+        }
+
+        l.setLocation(rows[19]); //This is the location
+        m.setLocation((l.x - MIN_LAT)*LAT_TO_METERS ,
+                      (l.y - MIN_LNG)*LNG_TO_METERS);
+
+        // COMPNOS, which is the same for every row of an incident
+        chunk.crimes.add(m, l, date, type, weapon, row, IncidentSet::keyOf(rows[0]));
+    }
+}
+
+// Finds the restauraunts near each of the chunk's crimes, JOIN_BATCH_SIZE crimes at a
+// time. The batch hands back each crime's restauraunts in order of crime, so the hits
+// come out in the same order as they would asking about one crime at a time
+void CrimeIngest::join(CrimeChunk& chunk, QueryBatch<Restauraunt>& batch,
+                       QueryBatch<Place>& layerBatch){
+    const CrimeTable& crimes = chunk.crimes;
+    for(size_t first=0;first<crimes.size();first+=JOIN_BATCH_SIZE){
+        size_t n = min((size_t)JOIN_BATCH_SIZE, crimes.size() - first);
+        // finds all restauraunts within a distance of CRIME_RADIUS from the metric
+        // coordinates of each crime
+        index.findNodesBatch(&crimes.xs[first], &crimes.ys[first], n, CRIME_RADIUS, batch);
+        for(size_t i=0;i<n;i++){
+            Restauraunt* const* found = batch.results(i);
+            for(size_t j=0;j<batch.count(i);j++){
+                CrimeHit hit = {(unsigned)(first + i), found[j]->id};
+                chunk.hits.push_back(hit);
+            }
+        }
+        // and the same crimes, while they are still in the cache, against every layer
+        if(!layers)
+            continue;
+        layers->index.findNodesBatch(&crimes.xs[first], &crimes.ys[first], n, CRIME_RADIUS,
+                                     layerBatch);
+        for(size_t i=0;i<n;i++){
+            Place* const* found = layerBatch.results(i);
+            for(size_t j=0;j<layerBatch.count(i);j++){
+                CrimeHit hit = {(unsigned)(first + i), found[j]->id};
+                chunk.layerHits.push_back(hit);
+            }
+        }
+    }
+}
+
+// Gives the chunk's incident types their numbers in the TypeDictionary. Types new to
+// the dictionary are numbered in the order they showed up in the file, which is why
+// the chunks have to come through here in order
+void CrimeIngest::numberTypes(CrimeChunk& chunk){
+    size_t n = min(chunk.typeNames.size(), (size_t)MAX_INCIDENT_TYPES);
+    chunk.typeIds.resize(n);
+    for(size_t i=0;i<n;i++)
+        chunk.typeIds[i] = types.id(chunk.typeNames.str(i),
+                                    chunk.typeNames.str(i) + chunk.typeNames.length(i));
+    costs.update(types);
+}
+
+// Folds the weapon flags of another row of the same incident into weapon: the worst
+// weapon of the two (firearm > knife > other > unarmed), and a shooting if either had one
+static unsigned char mergeWeapons(unsigned char weapon, unsigned char other){
+    unsigned char worst = (weapon & WEAPON_FLAG) > (other & WEAPON_FLAG) ?
+                          (weapon & WEAPON_FLAG) : (other & WEAPON_FLAG);
+    return worst | ((weapon | other) & SHOOTING_FLAG);
+}
+
+// Adds the chunk's crimes to the end of the table, renumbering their types with the
+// numbers for the whole file, and sets aside their hits for the links, in file order.
+// A crime whose incident is already in the table (another row of the same COMPNOS) is
+// folded into the one there instead, and its hits dropped, as the first row's hits
+// already link the incident to its restauraunts. Every first row's hits are kept, even
+// those of crimes that cost nothing so far: a later row can still raise the weapon, so
+// which crimes count is only decided in buildLinks(). The chunk is finished with after
+// this.
+void CrimeIngest::merge(CrimeChunk& chunk){
+    CrimeTable& crimes = chunk.crimes;
+    // where each of the chunk's crimes ended up in the table, or NO_CRIME if it was
+    // folded into an earlier one
+    const unsigned NO_CRIME = ~0u;
+    vector<unsigned> merged(crimes.size());
+    for(size_t i=0;i<crimes.size();i++){
+        crimes.types[i] = chunk.typeIds[crimes.types[i]];
+        crimes.rows[i] += rowsMerged;
+        unsigned next = (unsigned)table.size();
+        unsigned crime = incidents.insert(crimes.incidents[i], next);
+        if(crime == next){
+            table.append(crimes, i);
+            merged[i] = crime;
+        }else{
+            table.weapons[crime] = mergeWeapons(table.weapons[crime], crimes.weapons[i]);
+            if(crime < resumedCrimes)
+                resumedChanged = true;
+            merged[i] = NO_CRIME;
+            duplicates++;
+        }
+    }
+    for(const CrimeHit& hit : chunk.hits){
+        unsigned crime = merged[hit.crime];
+        if(crime == NO_CRIME)
+            continue;
+        CrimeHit link = {crime, hit.restauraunt};
+        pending.push_back(link);
+    }
+    for(const CrimeHit& hit : chunk.layerHits){
+        unsigned crime = merged[hit.crime];
+        if(crime != NO_CRIME){
+            CrimeHit link = {crime, hit.restauraunt};
+            layerPending.push_back(link);
+        }
+    }
+    crimesProcessed += crimes.size();
+    rowsMerged += chunk.rowCount;
+}
+
+// Crime.csv is only written once every row has been merged, as a later row of an
+// incident can change its weapon. Pieces of the table are turned into text in parallel,
+// a round of them at a time, and written out in order.
+void CrimeIngest::writeCrimes(ostream& crimeOut, size_t start){
+    size_t pieces = (table.size() - start + CRIME_WRITE_SIZE - 1)/CRIME_WRITE_SIZE;
+    vector<string> text(threads);
+    for(size_t first=0;first<pieces;first+=threads){
+        size_t n = min((size_t)threads, pieces - first);
+        parallelFor(n, [&](size_t i, int){
+            size_t from = start + (first + i)*CRIME_WRITE_SIZE;
+            ostringstream out;
+            table.write(out, from, min(from + CRIME_WRITE_SIZE, table.size()));
+            text[i] = out.str();
+        });
+        for(size_t i=0;i<n;i++)
+            crimeOut << text[i];
+    }
+}
+
+void CrimeIngest::resume(CrimeState& state){
+    table = std::move(state.table);
+    incidents.reserve(table.size());
+    for(size_t i=0;i<table.size();i++)
+        incidents.insert(table.incidents[i], (unsigned)i);
+    rowsMerged = state.rows;
+    resumeAt = state.watermark;
+    resumedCrimes = table.size();
+
+    // Which restauraunt each of the saved ones is now, if it is still around
+    vector<string> keys = CrimeState::keysOf(restauraunts);
+    unordered_map<string, int> ids;
+    for(size_t i=0;i<keys.size();i++)
+        ids.emplace(keys[i], (int)i);
+    vector<int> current(state.keys.size(), -1);
+    vector<bool> known(restauraunts.size(), false);
+    size_t closed = 0;
+    for(size_t k=0;k<state.keys.size();k++){
+        unordered_map<string, int>::const_iterator iter = ids.find(state.keys[k]);
+        if(iter == ids.end()){
+            closed++;
+            continue;
+        }
+        current[k] = iter->second;
+        known[iter->second] = true;
+    }
+    for(const CrimeHit& hit : state.hits){
+        if(current[hit.restauraunt] < 0)
+            continue;
+        CrimeHit link = {hit.crime, current[hit.restauraunt]};
+        pending.push_back(link);
+    }
+    vector<Restauraunt*> added;
+    for(size_t i=0;i<restauraunts.size();i++)
+        if(!known[i])
+            added.push_back(restauraunts[i]);
+    linkAdded(added);
+    linkLayers();
+    *log << "Resuming from " << resumedCrimes << " crimes, with " << added.size()
+         << " new restauraunts and " << closed << " closed\n";
+}
+
+// The new restauraunts are put in a KdTree of their own, and every crime already read
+// is looked up in it; the crimes read from here on are joined with them as usual
+void CrimeIngest::linkAdded(const vector<Restauraunt*>& added){
+    if(added.empty())
+        return;
+    KdTree<Restauraunt> tree;
+    for(Restauraunt* r : added)
+        tree.insert(r->metricLocation(), r);
+    tree.build();
+    QueryBatch<Restauraunt>& batch = batches[0];
+    for(size_t first=0;first<table.size();first+=JOIN_BATCH_SIZE){
+        size_t n = min((size_t)JOIN_BATCH_SIZE, table.size() - first);
+        tree.findNodesBatch(&table.xs[first], &table.ys[first], n, CRIME_RADIUS, batch);
+        for(size_t i=0;i<n;i++){
+            unsigned crime = (unsigned)(first + i);
+            Restauraunt* const* found = batch.results(i);
+            for(size_t j=0;j<batch.count(i);j++){
+                CrimeHit link = {crime, found[j]->id};
+                pending.push_back(link);
+            }
+        }
+    }
+}
+
+// The saved state doesn't have the layers' links (which layers there are can change
+// from one run to the next), so the crimes read then are looked up in them again
+void CrimeIngest::linkLayers(){
+    if(!layers)
+        return;
+    QueryBatch<Place>& batch = layerBatches[0];
+    for(size_t first=0;first<table.size();first+=JOIN_BATCH_SIZE){
+        size_t n = min((size_t)JOIN_BATCH_SIZE, table.size() - first);
+        layers->index.findNodesBatch(&table.xs[first], &table.ys[first], n, CRIME_RADIUS, batch);
+        for(size_t i=0;i<n;i++){
+            unsigned crime = (unsigned)(first + i);
+            Place* const* found = batch.results(i);
+            for(size_t j=0;j<batch.count(i);j++){
+                CrimeHit link = {crime, found[j]->id};
+                layerPending.push_back(link);
+            }
+        }
+    }
+}
+
+void CrimeIngest::save(CrimeState& state, const char* path){
+    state.watermark = bytesRead;
+    state.rows = rowsMerged;
+    state.fingerprint = CrimeState::fingerprintOf(path, bytesRead);
+    state.table = table;
+    state.keys = CrimeState::keysOf(restauraunts);
+    state.hits = pending;
+}
+
+// If the initial cost is 0, no need to add the crime, as that means it was ignorable?
+// Basically I just decided that a MedAssist incident probably shouldn't be counted,
+// although I don't actually kknow what that means, its frequency and name suggests
+// that perhaps the police were merely assisting with something of a medical nature.
+// (Which types are ignored is up to the TypeDictionary and the cost file.)
+void CrimeIngest::buildLinks(){
+    // (after a resume with nothing new to read, no chunk has updated the costs yet)
+    costs.update(types);
+    vector<CrimeHit> counted;
+    for(const CrimeHit& hit : pending)
+        if(costs.initialCost(table.types[hit.crime], table.weapons[hit.crime]) > 0)
+            counted.push_back(hit);
+    links.build(counted, restauraunts.size(), table);
+    if(layers){
+        counted.clear();
+        for(const CrimeHit& hit : layerPending)
+            if(costs.initialCost(table.types[hit.crime], table.weapons[hit.crime]) > 0)
+                counted.push_back(hit);
+        layers->links.build(counted, layers->places.size(), table);
+        vector<CrimeHit>().swap(layerPending);
+    }
+}
+
+// Goes over every restauraunt's crimes, a restauraunt per task, adding up the cost of
+// each crime to the restauraunt, and rounding the total. Crimes with no date can't be
+// decayed, and are left out (a restauraunt with no licence date, like a place, is
+// opened on INVALID_DAY, before any crime). This is instantiated for each decay policy, so the
+// policy's cost() is inlined right into the loop
+template<class Decay>
+void CrimeIngest::scoreWith(const Decay& decay){
+    int today = now.epochDay();
+    const int* days = table.days.data();
+    const unsigned char* types = table.types.data();
+    const unsigned char* weapons = table.weapons.data();
+    parallelFor(restauraunts.size(), [&](size_t i, int){
+        Restauraunt* r = restauraunts[i];
+        int opened = r->date.epochDay();
+        double crimeCost = 0;
+        links.forEach(r->id, [&](unsigned crime){
+            if(days[crime] == INVALID_DAY)
+                return;
+            crimeCost += decay.cost(costs.initialCost(types[crime], weapons[crime]),
+                                    days[crime], opened, today);
+        });
+        r->crimeCost += (int)llround(crimeCost);
+    });
+    // Places have no licence date, so every crime is as if it happened since they opened
+    if(!layers)
+        return;
+    parallelFor(layers->places.size(), [&](size_t i, int){
+        Place* p = layers->places[i];
+        double crimeCost = 0;
+        layers->links.forEach(p->id, [&](unsigned crime){
+            if(days[crime] == INVALID_DAY)
+                return;
+            crimeCost += decay.cost(costs.initialCost(types[crime], weapons[crime]),
+                                    days[crime], INVALID_DAY, today);
+        });
+        p->crimeCost += (int)llround(crimeCost);
+    });
+}
+
+void CrimeIngest::score(){
+    switch(costs.decay){
+        case DECAY_RECENCY:
+            scoreWith(costs.recency);
+            break;
+        case DECAY_HALF_LIFE:
+            scoreWith(costs.halfLife);
+            break;
+        case DECAY_NONE:
+            scoreWith(costs.none);
+            break;
+    }
+}
+
+// Much the same, for every set of the sweep, which does the work of going across the sets
+void CrimeIngest::sweep(const CostSweep& sweep, vector<double>& scores){
+    int today = now.epochDay();
+    scores.assign(restauraunts.size()*sweep.size(), 0);
+    parallelFor(restauraunts.size(), [&](size_t i, int){
+        Restauraunt* r = restauraunts[i];
+        sweep.score(links, table, r->id, r->date.epochDay(), today, &scores[i*sweep.size()]);
+    });
+}
+
+// Each thread looks up pieces of the table JOIN_BATCH_SIZE crimes at a time, just as
+// the join does, and adds what it finds to rings of its own, which are added together
+// at the end. The cost of a crime is worked out just as score() does, and then weighed
+// by its distance
+template<class Decay>
+void CrimeIngest::scoreRingsWith(Rings& rings, const Decay& decay){
+    int today = now.epochDay();
+    vector<Rings> totals(threads, rings);
+    for(Rings& total : totals)
+        total.reset(restauraunts.size());
+    size_t pieces = (table.size() + JOIN_BATCH_SIZE - 1)/JOIN_BATCH_SIZE;
+    parallelFor(pieces, [&](size_t piece, int thread){
+        QueryBatch<Restauraunt>& batch = batches[thread];
+        Rings& total = totals[thread];
+        size_t first = piece*JOIN_BATCH_SIZE;
+        size_t n = min((size_t)JOIN_BATCH_SIZE, table.size() - first);
+        index.findNodesBatch(&table.xs[first], &table.ys[first], n, rings.outer(), batch);
+        for(size_t i=0;i<n;i++){
+            size_t crime = first + i;
+            double initialCost = costs.initialCost(table.types[crime], table.weapons[crime]);
+            // the same crimes the links leave out, and those score() does
+            if(initialCost <= 0 || table.days[crime] == INVALID_DAY)
+                continue;
+            Restauraunt* const* found = batch.results(i);
+            for(size_t j=0;j<batch.count(i);j++){
+                Restauraunt* r = found[j];
+                Location l = r->metricLocation();
+                double dx = table.xs[crime] - l.x, dy = table.ys[crime] - l.y;
+                double distance = sqrt(dx*dx + dy*dy);
+                double cost = decay.cost(initialCost, table.days[crime], r->date.epochDay(), today);
+                total.add(r->id, rings.ringOf(distance), cost*rings.weight(distance));
+            }
+        }
+    });
+    rings.reset(restauraunts.size());
+    for(const Rings& total : totals)
+        rings.add(total);
+}
+
+void CrimeIngest::scoreRings(Rings& rings){
+    switch(costs.decay){
+        case DECAY_RECENCY:
+            scoreRingsWith(rings, costs.recency);
+            break;
+        case DECAY_HALF_LIFE:
+            scoreRingsWith(rings, costs.halfLife);
+            break;
+        case DECAY_NONE:
+            scoreRingsWith(rings, costs.none);
+            break;
+    }
+}
+
+// The series only need the links, which are already sorted by day, so each restauraunt
+// is one scan of its crimes, with no decay to choose. The series starts at the first
+// dated crime linked to any restauraunt, so the crimes nobody is near don't stretch it
+size_t CrimeIngest::scoreSeries(TimeSeries& series){
+    int today = now.epochDay();
+    int first = today;
+    for(Restauraunt* r : restauraunts)
+        links.forEach(r->id, [&](unsigned crime){
+            if(table.days[crime] != INVALID_DAY)
+                first = min(first, table.days[crime]);
+        });
+    series.reset(restauraunts.size(), first, today);
+    atomic<size_t> leftOut(0);
+    parallelFor(restauraunts.size(), [&](size_t i, int){
+        size_t r = restauraunts[i]->id;
+        size_t missed = 0;
+        links.forEach(r, [&](unsigned crime){
+            if(table.days[crime] == INVALID_DAY)
+                return;
+            if(!series.add(r, series.periodOf(table.days[crime]),
+                           costs.initialCost(table.types[crime], table.weapons[crime])))
+                missed++;
+        });
+        series.accumulate(r);
+        leftOut += missed;
+    });
+    return leftOut;
+}
+
+// The pipeline: one thread reads and cuts up the file, parsers and joiners take chunks
+// from the queue in front of them as soon as they are free, and the writer collects the
+// chunks, puts them back in file order, and numbers, scores, writes and merges them just
+// as run() does. The last parser (or joiner) to finish closes the queue after it.
+bool CrimeIngest::runPipeline(const char* path, ostream& statsOut){
+    InputFile file(path);
+    if(!file.isOpen())
+        return false;
+    int workers = threads/2 > 1 ? threads/2 : 1;
+
+    BoundedQueue<CrimeChunk*> toParse(PIPELINE_QUEUE_SIZE, "read -> parse");
+    BoundedQueue<CrimeChunk*> toJoin (PIPELINE_QUEUE_SIZE, "parse -> join");
+    BoundedQueue<CrimeChunk*> toWrite(PIPELINE_QUEUE_SIZE, "join -> write");
+    atomic<int> parsersLeft(workers), joinersLeft(workers);
+
+    thread reader([&](){
+        const char* begin;
+        const char* end;
+        bool copy = file.isCompressed();
+        size_t sequence = 0;
+        while(nextBlock(file, begin, end)){
+            const char* start = begin;
+            while(start < end){
+                const char* stop = start + PIPELINE_CHUNK_SIZE < end ?
+                                   nextRow(start + PIPELINE_CHUNK_SIZE, end) : end;
+                CrimeChunk* chunk = new CrimeChunk;
+                chunk->sequence = sequence++;
+                if(copy){
+                    // The InputFile reuses its buffer for the next block, which will be
+                    // read long before this chunk is parsed
+                    chunk->storage.assign(start, stop);
+                    chunk->storage.push_back('\0');
+                    chunk->begin = &chunk->storage[0];
+                    chunk->end   = chunk->begin + (stop - start);
+                }else{
+                    chunk->begin = start;
+                    chunk->end   = stop;
+                }
+                toParse.push(chunk);
+                start = stop;
+            }
+        }
+        toParse.close();
+    });
+
+    vector<thread> pool;
+    for(int i=0;i<workers;i++){
+        pool.push_back(thread([&](){
+            CrimeChunk* chunk;
+            while(toParse.pop(chunk)){
+                parse(*chunk);
+                toJoin.push(chunk);
+            }
+            if(--parsersLeft == 0)
+                toJoin.close();
+        }));
+        pool.push_back(thread([&](){
+            QueryBatch<Restauraunt> batch;
+            QueryBatch<Place> layerBatch;
+            CrimeChunk* chunk;
+            while(toJoin.pop(chunk)){
+                join(*chunk, batch, layerBatch);
+                toWrite.push(chunk);
+            }
+            if(--joinersLeft == 0)
+                toWrite.close();
+        }));
+    }
+
+    // The writer is this thread. Chunks can finish out of order, so they wait in
+    // waiting (indexed by sequence) until every chunk before them has been written
+    vector<CrimeChunk*> waiting;
+    size_t nextSequence = 0;
+    CrimeChunk* chunk;
+    while(toWrite.pop(chunk)){
+        if(chunk->sequence >= waiting.size())
+            waiting.resize(chunk->sequence + 1, NULL);
+        waiting[chunk->sequence] = chunk;
+        while(nextSequence < waiting.size() && waiting[nextSequence]){
+            CrimeChunk* next = waiting[nextSequence];
+            numberTypes(*next);
+            merge(*next);
+            delete next;
+            waiting[nextSequence] = NULL;
+            nextSequence++;
+        }
+    }
+    reader.join();
+    for(thread& t : pool)
+        t.join();
+    if(cutShort)
+        return shortened();
+    *log << crimesProcessed << " crimes processed\n";
+    *log << duplicates << " rows were more of an incident already read\n";
+    buildLinks();
+
+    toParse.printStats(statsOut);
+    toJoin.printStats(statsOut);
+    toWrite.printStats(statsOut);
+    return true;
+}
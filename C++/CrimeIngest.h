@@ -0,0 +1,222 @@
+/******************************************************************************
+ * CrimeIngest.h                                                              *
+ *                                                                            *
+ * The crime pass: reading every crime in the (huge) crime file, finding the  *
+ * restauraunts within CRIME_RADIUS of each one, and adding the crime to them.*
+ *                                                                            *
+ * The file is cut into chunks of whole rows which are handed out to a pool   *
+ * of threads. Each thread parses its chunks into a CrimeTable of their own   *
+ * and queries the spatial index (only ever read from by this point) for the  *
+ * hits, so nothing is shared while the threads run. The chunks are then      *
+ * merged back together, in file order, into one CrimeTable, so the result is *
+ * exactly the same as reading the file one row at a time, whatever the       *
+ * number of threads. Rows of an incident already in the table (the export    *
+ * has a row per offense) are folded into it as they are merged. Once every   *
+ * crime is in, the hits are turned into CrimeLinks, writeCrimes() writes     *
+ * Crime.csv from the table, and score() works out each restauraunt's crime   *
+ * cost from the links in a pass of its own.                                  *
+ *                                                                            *
+ * Crimes can also be linked to the places of any number of other Layers      *
+ * (bars, schools and so on) in the same pass: join() probes the layers'      *
+ * index right after the restauraunts', and the places are scored along with  *
+ * the restauraunts.                                                          *
+ *                                                                            *
+ * The table and links can be saved to a CrimeState, and the next run can     *
+ * resume() from it, reading only the rows added to the file since.           *
+ *                                                                            *
+ * Alternatively, runPipeline() does the same work as a pipeline of stages    *
+ * connected by BoundedQueues: a reader thread cutting the file into chunks,  *
+ * parser threads, join threads querying the index, and a writer thread       *
+ * putting the chunks back in order and merging them. That way reading the    *
+ * disk overlaps with everything else, rather than each block of the file     *
+ * waiting on the last.                                                       *
+ ******************************************************************************/
+
+#ifndef CRIME_INGEST
+#define CRIME_INGEST
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "CostSweep.h"
+#include "Crime.h"
+#include "CrimeLinks.h"
+#include "CrimeState.h"
+#include "CrimeTable.h"
+#include "IncidentSet.h"
+#include "InputFile.h"
+#include "Layers.h"
+#include "Date.h"
+#include "Location.h"
+#include "QueryBatch.hpp"
+#include "Restauraunt.h"
+#include "Rings.h"
+#include "SpatialIndex.hpp"
+#include "StringPool.h"
+#include "TimeSeries.h"
+#include "TypeDictionary.h"
+
+// each thread's share of a block is cut into this many chunks, so that a thread that
+// finishes early can pick up some of the slack
+#define CHUNKS_PER_THREAD 4
+
+// the pipeline cuts the file into chunks of about this many bytes, and allows this many
+// chunks to wait between any two stages
+#define PIPELINE_CHUNK_SIZE (1 << 20)
+#define PIPELINE_QUEUE_SIZE 16
+
+// crimes are looked up in the spatial index this many at a time
+#define JOIN_BATCH_SIZE 4096
+
+// and written out to Crime.csv this many at a time on each thread
+#define CRIME_WRITE_SIZE 65536
+
+// a run of whole rows of the crime file, and everything read from them
+struct CrimeChunk{
+    // the rows, which point into the mapped file, or into storage when the file isn't
+    // mapped and the pipeline needs the rows to outlive the InputFile's buffer
+    const char* begin;
+    const char* end;
+    std::vector<char> storage;
+    // where the chunk falls in the file
+    size_t sequence;
+    // the chunk's crimes, with rows counted from the start of the chunk until it is
+    // merged, and the number of rows read (kept or not)
+    CrimeTable crimes;
+    unsigned rowCount;
+    // the crimes near restauraunts, as indices into the chunk's table
+    std::vector<CrimeHit> hits;
+    // and the crimes near the layers' places
+    std::vector<CrimeHit> layerHits;
+    // the incident types in the order they were first seen in this chunk, which is
+    // what the crimes' types refer to until they are given their TypeDictionary numbers
+    StringPool typeNames;
+    std::vector<unsigned char> typeIds;
+};
+
+class CrimeIngest{
+public:
+    CrimeIngest(SpatialIndex<Restauraunt>& index, std::vector<Restauraunt*>& restauraunts,
+                TypeDictionary& types, CostModel& costs, int threads);
+   ~CrimeIngest();
+
+    // links the crimes to the places of layers (which have already been read) as well,
+    // from the next run on, and scores them too
+    void addLayers(Layers& layers);
+
+    // reads every crime in the file at path into the table, one crime per incident,
+    // linking each to the restauraunts within CRIME_RADIUS of it. Returns false if
+    // the file couldn't be opened, or (after a resume) turned out shorter than what
+    // the resumed run had already read, in which case nothing read can be trusted
+    bool run(const char* path);
+
+    // does exactly the same as run, with the stages of the work running side by side
+    // instead (see above). The queue statistics are printed to statsOut at the end
+    bool runPipeline(const char* path, std::ostream& statsOut);
+
+    // Picks up where the run that saved state left off, before run (or runPipeline)
+    // reads just the rows added to the file since. Restauraunts that weren't around
+    // then have every crime already read linked to them, and those that have closed
+    // are forgotten
+    void resume(CrimeState& state);
+    // saves everything run worked out into state, for the next run to resume from
+    void save(CrimeState& state, const char* path);
+
+    // writes a row of Crime.csv for each crime from first on
+    void writeCrimes(std::ostream& crimeOut, size_t first);
+
+    // works out the crime cost of every restauraunt from the crimes linked to it, with
+    // the CostModel's decay policy
+    void score();
+
+    // works out the crime cost of every restauraunt under every set of the sweep at
+    // once, into scores (a row of sweep.size() for each restauraunt in turn)
+    void sweep(const CostSweep& sweep, std::vector<double>& scores);
+
+    // counts and costs the crimes around every restauraunt by ring, looking every crime
+    // up again at the rings' outer radius
+    void scoreRings(Rings& rings);
+
+    // counts and costs the crimes linked to every restauraunt by the period they
+    // happened in, from the first of them to today, returning how many were left out
+    // for being dated after today
+    size_t scoreSeries(TimeSeries& series);
+
+    // where the progress of the run is printed (cout, unless changed)
+    std::ostream* log;
+
+    long long crimesProcessed;
+    // how many rows were folded into an incident read before them
+    long long duplicates;
+    // how many crimes came from the state resumed from, and whether any of them were
+    // changed by a row read since (in which case all of Crime.csv needs writing again)
+    size_t resumedCrimes;
+    bool resumedChanged;
+    // every crime read, in file order, and the crimes near each restauraunt (once run
+    // has finished)
+    CrimeTable table;
+    CrimeLinks links;
+
+private:
+    CrimeIngest(const CrimeIngest&);
+    CrimeIngest& operator=(const CrimeIngest&);
+
+    bool nextBlock(InputFile& file, const char*& begin, const char*& end);
+    bool shortened();
+    void processBlock(const char* begin, const char* end);
+    void parse(CrimeChunk& chunk);
+    void join(CrimeChunk& chunk, QueryBatch<Restauraunt>& batch, QueryBatch<Place>& layerBatch);
+    void numberTypes(CrimeChunk& chunk);
+    void merge(CrimeChunk& chunk);
+    template<class Decay>
+    void scoreWith(const Decay& decay);
+    template<class Decay>
+    void scoreRingsWith(Rings& rings, const Decay& decay);
+
+    // calls work(i, thread) for every i in [0, n), spread over the threads
+    template<class F>
+    void parallelFor(size_t n, F work);
+
+    SpatialIndex<Restauraunt>& index;
+    std::vector<Restauraunt*>& restauraunts;
+    // There were only like 30 destinct incident types, not all of which I understood,
+    // so each is just given a number, which new types get from here
+    TypeDictionary& types;
+    // and what each type of crime costs, which is filled in as they are numbered
+    CostModel& costs;
+    int threads;
+    Date now;
+    // each thread's batch of queries, reused for every chunk it joins
+    std::vector<QueryBatch<Restauraunt> > batches;
+    std::vector<QueryBatch<Place> > layerBatches;
+    // the other places the crimes are linked to, if any, and their hits waiting for
+    // their links, as for the restauraunts'
+    Layers* layers;
+    std::vector<CrimeHit> layerPending;
+    // how many rows have been merged so far
+    unsigned rowsMerged;
+    // how many bytes of the file have been handed out by nextBlock (read or skipped),
+    // and how many were read by the run resumed from
+    unsigned long long bytesRead, resumeAt;
+    // whether the file ran out before resumeAt
+    bool cutShort;
+    // every hit merged so far, whatever its crime costs, waiting for the links to be
+    // built out of them (and then kept, for save)
+    std::vector<CrimeHit> pending;
+    // the incidents (COMPNOS) merged so far, and the crime each became
+    IncidentSet incidents;
+    // links the crimes of the pending hits that cost something, now that every row has
+    // been merged and their weapons are final
+    void buildLinks();
+    // links the restauraunts that weren't around in the state resumed from to every
+    // crime read then
+    void linkAdded(const std::vector<Restauraunt*>& added);
+    // links every crime read in the state resumed from to the layers' places
+    void linkLayers();
+
+    // finds the start of the first row at or after p
+    static const char* nextRow(const char* p, const char* end);
+};
+
+#endif
@@ -0,0 +1,81 @@
+/******************************************************************************
+ * CrimeLinks.cpp                                                             *
+ *                                                                            *
+ * Which crimes are near which restauraunt, built in one go and stored        *
+ * compressed sparse row style.                                               *
+ ******************************************************************************/
+
+#include "CrimeLinks.h"
+
+#include <algorithm>
+
+using namespace std;
+
+CrimeLinks::CrimeLinks(){
+    compressed = false;
+    total = 0;
+    offsets.assign(1, 0);
+}
+
+void CrimeLinks::build(const vector<CrimeHit>& hits, size_t restauraunts,
+                       const CrimeTable& table){
+    compressed = false;
+    total = hits.size();
+    vector<unsigned char>().swap(packed);
+    vector<unsigned>().swap(counts);
+
+    // count, then add up the counts so offsets[r] is where restauraunt r's links start
+    offsets.assign(restauraunts + 1, 0);
+    for(const CrimeHit& hit : hits)
+        offsets[hit.restauraunt + 1]++;
+    for(size_t r=0;r<restauraunts;r++)
+        offsets[r + 1] += offsets[r];
+
+    // then fill, using next to keep track of where each restauraunt is up to
+    ids.resize(hits.size());
+    vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for(const CrimeHit& hit : hits)
+        ids[next[hit.restauraunt]++] = hit.crime;
+
+    const vector<int>& days = table.days;
+    for(size_t r=0;r<restauraunts;r++){
+        sort(ids.begin() + offsets[r], ids.begin() + offsets[r + 1],
+             [&](unsigned a, unsigned b){
+                 return days[a] < days[b] || (days[a] == days[b] && a < b);
+             });
+    }
+}
+
+void CrimeLinks::compress(){
+    if(compressed)
+        return;
+    size_t restauraunts = size();
+    counts.resize(restauraunts);
+    packed.clear();
+    packed.reserve(ids.size()*2);
+    for(size_t r=0;r<restauraunts;r++){
+        size_t first = offsets[r], last = offsets[r + 1];
+        counts[r] = (unsigned)(last - first);
+        offsets[r] = packed.size();
+        unsigned previous = 0;
+        for(size_t i=first;i<last;i++){
+            long long delta = (long long)ids[i] - (long long)previous;
+            unsigned long long zigzag = ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63);
+            while(zigzag >= 0x80){
+                packed.push_back((unsigned char)(zigzag | 0x80));
+                zigzag >>= 7;
+            }
+            packed.push_back((unsigned char)zigzag);
+            previous = ids[i];
+        }
+    }
+    offsets[restauraunts] = packed.size();
+    packed.shrink_to_fit();
+    vector<unsigned>().swap(ids);
+    compressed = true;
+}
+
+size_t CrimeLinks::bytes() const{
+    return offsets.size()*sizeof(size_t) + ids.size()*sizeof(unsigned) +
+           packed.size() + counts.size()*sizeof(unsigned);
+}
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * CrimeLinks.h                                                               *
+ *                                                                            *
+ * Which crimes are near which restauraunt, for every restauraunt, in one     *
+ * place. Rather than a vector of crimes per restauraunt, each grown a        *
+ * push_back at a time, the links are built in one go once every crime is in: *
+ * the crimes near each restauraunt are counted, the counts are added up into *
+ * where each restauraunt's crimes start, and then the crimes (as 32 bit      *
+ * indices into the CrimeTable) are filled in. Each restauraunt's crimes sit  *
+ * next to each other, sorted by date, so going over them is a straight scan. *
+ *                                                                            *
+ * The links can be squeezed further with compress(), which stores each      *
+ * crime as the difference from the one before it, in as few bytes as that   *
+ * takes. forEach() reads them the same way either way.                       *
+ ******************************************************************************/
+
+#ifndef CRIME_LINKS
+#define CRIME_LINKS
+
+#include <cstddef>
+#include <vector>
+
+#include "CrimeTable.h"
+
+// a crime within CRIME_RADIUS of a restauraunt
+struct CrimeHit{
+    unsigned crime;  // index into a CrimeTable
+    int restauraunt; // Restauraunt::id
+};
+
+class CrimeLinks{
+public:
+    CrimeLinks();
+
+    // builds the links for restauraunts [0, restauraunts) out of hits, sorting each
+    // restauraunt's crimes by their day in table (and by index on the same day)
+    void build(const std::vector<CrimeHit>& hits, size_t restauraunts,
+               const CrimeTable& table);
+
+    // delta encodes the links (see above)
+    void compress();
+    bool isCompressed() const { return compressed; }
+
+    // the number of restauraunts, and the number of links in all
+    size_t size() const { return offsets.size() - 1; }
+    size_t links() const { return total; }
+    // how many crimes are linked to restauraunt r
+    size_t count(size_t r) const { return counts.empty() ? offsets[r + 1] - offsets[r] : counts[r]; }
+    // how many bytes the links take up
+    size_t bytes() const;
+
+    // calls visit(crime) for each of the crimes linked to restauraunt r, in order
+    template<class F>
+    void forEach(size_t r, F visit) const;
+
+private:
+    bool compressed;
+    size_t total;
+    // restauraunt r's links are ids[offsets[r]] up to ids[offsets[r + 1]], or once
+    // compressed, the bytes packed[offsets[r]] up to packed[offsets[r + 1]]
+    std::vector<size_t> offsets;
+    std::vector<unsigned> ids;
+    std::vector<unsigned char> packed;
+    // once compressed, how many links each restauraunt has
+    std::vector<unsigned> counts;
+};
+
+// Each compressed link is the difference from the link before it (from 0 for the first),
+// zigzag encoded (0, -1, 1, -2, ... become 0, 1, 2, 3, ...) since dates and indices
+// don't go up together, then written 7 bits a byte, with the top bit set on every byte
+// but the last
+template<class F>
+void CrimeLinks::forEach(size_t r, F visit) const{
+    if(!compressed){
+        for(size_t i=offsets[r];i<offsets[r + 1];i++)
+            visit(ids[i]);
+        return;
+    }
+    const unsigned char* p = packed.data() + offsets[r];
+    const unsigned char* end = packed.data() + offsets[r + 1];
+    unsigned last = 0;
+    while(p < end){
+        unsigned long long zigzag = 0;
+        int shift = 0;
+        unsigned char byte;
+        do{
+            byte = *p++;
+            zigzag |= (unsigned long long)(byte & 0x7F) << shift;
+            shift += 7;
+        }while(byte & 0x80);
+        long long delta = (long long)(zigzag >> 1) ^ -(long long)(zigzag & 1);
+        last = (unsigned)((long long)last + delta);
+        visit(last);
+    }
+}
+
+#endif
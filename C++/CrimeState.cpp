@@ -0,0 +1,165 @@
+/******************************************************************************
+ * CrimeState.cpp                                                             *
+ *                                                                            *
+ * Everything the crime pass worked out, saved between runs.                  *
+ ******************************************************************************/
+
+#include "CrimeState.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#include "InputFile.h"
+
+using namespace std;
+
+// the first 8 bytes of every state file
+static const char MAGIC[8] = {'C', 'R', 'I', 'M', 'E', 'S', 'T', 'A'};
+
+CrimeState::CrimeState(){
+    watermark = 0;
+    rows = 0;
+    fingerprint = 0;
+}
+
+// Plain old data is written as its bytes, and vectors of it as their size followed by
+// their elements
+template<class T>
+static void writeValue(ostream& out, const T& value){
+    out.write((const char*)&value, sizeof(T));
+}
+
+template<class T>
+static void writeVector(ostream& out, const vector<T>& v){
+    unsigned long long n = v.size();
+    writeValue(out, n);
+    if(n)
+        out.write((const char*)v.data(), n*sizeof(T));
+}
+
+template<class T>
+static bool readValue(istream& in, T& value){
+    return (bool)in.read((char*)&value, sizeof(T));
+}
+
+template<class T>
+static bool readVector(istream& in, vector<T>& v){
+    unsigned long long n;
+    if(!readValue(in, n))
+        return false;
+    v.resize(n);
+    return n == 0 || (bool)in.read((char*)v.data(), n*sizeof(T));
+}
+
+bool CrimeState::load(const char* path){
+    ifstream in(path, ios::binary);
+    char magic[sizeof(MAGIC)];
+    int version;
+    if(!in.read(magic, sizeof(MAGIC)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       !readValue(in, version) || version != CRIME_STATE_VERSION)
+        return false;
+    bool ok = readValue(in, watermark) && readValue(in, rows) && readValue(in, fingerprint) &&
+              readVector(in, table.xs) && readVector(in, table.ys) &&
+              readVector(in, table.lats) && readVector(in, table.lngs) &&
+              readVector(in, table.days) && readVector(in, table.types) &&
+              readVector(in, table.weapons) && readVector(in, table.rows) &&
+              readVector(in, table.incidents) && readVector(in, hits);
+    // the keys, as their lengths and then all of their characters
+    vector<unsigned> lengths;
+    vector<char> chars;
+    ok = ok && readVector(in, lengths) && readVector(in, chars);
+    if(!ok)
+        return false;
+    keys.clear();
+    size_t at = 0;
+    for(unsigned length : lengths){
+        if(at + length > chars.size())
+            return false;
+        keys.push_back(string(&chars[at], length));
+        at += length;
+    }
+    // every column should be as long as the others
+    size_t n = table.xs.size();
+    if(table.ys.size() != n || table.lats.size() != n || table.lngs.size() != n ||
+       table.days.size() != n || table.types.size() != n || table.weapons.size() != n ||
+       table.rows.size() != n || table.incidents.size() != n)
+        return false;
+    // and every hit has to be of a crime and a restauraunt that are there, as they are
+    // used to index both without looking
+    for(const CrimeHit& hit : hits)
+        if(hit.crime >= n || hit.restauraunt < 0 || (size_t)hit.restauraunt >= keys.size())
+            return false;
+    return true;
+}
+
+bool CrimeState::save(const char* path) const{
+    ofstream out(path, ios::binary);
+    out.write(MAGIC, sizeof(MAGIC));
+    writeValue(out, (int)CRIME_STATE_VERSION);
+    writeValue(out, watermark);
+    writeValue(out, rows);
+    writeValue(out, fingerprint);
+    writeVector(out, table.xs);
+    writeVector(out, table.ys);
+    writeVector(out, table.lats);
+    writeVector(out, table.lngs);
+    writeVector(out, table.days);
+    writeVector(out, table.types);
+    writeVector(out, table.weapons);
+    writeVector(out, table.rows);
+    writeVector(out, table.incidents);
+    writeVector(out, hits);
+    vector<unsigned> lengths;
+    vector<char> chars;
+    for(const string& key : keys){
+        lengths.push_back((unsigned)key.size());
+        chars.insert(chars.end(), key.begin(), key.end());
+    }
+    writeVector(out, lengths);
+    writeVector(out, chars);
+    return (bool)out;
+}
+
+vector<string> CrimeState::keysOf(const vector<Restauraunt*>& restauraunts){
+    vector<string> keys;
+    unordered_map<string, int> seen;
+    for(const Restauraunt* r : restauraunts){
+        ostringstream key;
+        key << Restauraunt::strings.str(r->name) << '\n'
+            << Restauraunt::strings.str(r->address) << '\n' << r->date.epochDay();
+        int times = seen[key.str()]++;
+        if(times)
+            key << '#' << times;
+        keys.push_back(key.str());
+    }
+    return keys;
+}
+
+// FNV-1a over the start of the file, which takes in the header and the first rows
+unsigned long long CrimeState::fingerprintOf(const char* path, unsigned long long length){
+    if(length > FINGERPRINT_BYTES)
+        length = FINGERPRINT_BYTES;
+    InputFile file(path);
+    const char* begin;
+    const char* end;
+    if(!file.isOpen() || !file.nextBlock(begin, end) || (unsigned long long)(end - begin) < length)
+        return 0;
+    unsigned long long h = 14695981039346656037ULL;
+    for(const char* p=begin;p<begin + length;p++){
+        h ^= (unsigned char)*p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+bool CrimeState::reaches(const char* path, unsigned long long length){
+    InputFile file(path);
+    const char* begin;
+    const char* end;
+    unsigned long long seen = 0;
+    while(seen < length && file.isOpen() && file.nextBlock(begin, end))
+        seen += end - begin;
+    return seen >= length;
+}
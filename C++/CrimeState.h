@@ -0,0 +1,77 @@
+/******************************************************************************
+ * CrimeState.h                                                               *
+ *                                                                            *
+ * Everything the crime pass worked out, saved between runs so that the next *
+ * run (with ./analyze -u) only has to read the rows added to the crime file  *
+ * since, rather than the whole history all over again:                       *
+ *                                                                            *
+ *  - how far into the crime file the last run got (the watermark), how many  *
+ *    rows that was, and a fingerprint of the start of the file, so a file    *
+ *    that has been replaced rather than added to isn't mistaken for the old  *
+ *    one                                                                     *
+ *  - every crime read (the CrimeTable, whose incident numbers are all the    *
+ *    IncidentSet needs to be rebuilt from)                                   *
+ *  - which crimes are near which restauraunt, with the restauraunts known by *
+ *    their name, address and licence date rather than their place in the    *
+ *    licence file, so licences opening and closing don't confuse anything.   *
+ *    The crimes that cost nothing are in there too: a later row of their    *
+ *    incident, or another cost file, can make them cost something, and then *
+ *    they are linked like any other                                          *
+ *                                                                            *
+ * The crime costs themselves aren't saved: they depend on today's date, so   *
+ * they have to be worked out again every day anyway (which only takes a pass *
+ * over the links).                                                           *
+ *                                                                            *
+ * The file is just those, one after another, in binary, behind a magic       *
+ * number and a version.                                                      *
+ ******************************************************************************/
+
+#ifndef CRIME_STATE
+#define CRIME_STATE
+
+#include <string>
+#include <vector>
+
+#include "CrimeLinks.h"
+#include "CrimeTable.h"
+#include "Restauraunt.h"
+
+#define CRIME_STATE_VERSION 4
+
+// the fingerprint of the crime file covers this many bytes from the start of it
+#define FINGERPRINT_BYTES 4096
+
+class CrimeState{
+public:
+    CrimeState();
+
+    // reads the state saved at path, returning false if there isn't any (or it is
+    // from another version, cut short, or has hits of crimes or restauraunts it
+    // doesn't have)
+    bool load(const char* path);
+    bool save(const char* path) const;
+
+    // The key each restauraunt is known by from one run to the next. A restauraunt
+    // listed more than once gets a count on the end of its key for every time after
+    // the first, so every key is different
+    static std::vector<std::string> keysOf(const std::vector<Restauraunt*>& restauraunts);
+
+    // a hash of the first length bytes of the crime file at path (or the first
+    // FINGERPRINT_BYTES, if length is more), or 0 if it isn't that long
+    static unsigned long long fingerprintOf(const char* path, unsigned long long length);
+    // whether the crime file at path is at least length bytes long (once inflated, for
+    // a .gz, which means inflating that much of it)
+    static bool reaches(const char* path, unsigned long long length);
+
+    // how many bytes of the crime file have been read, and how many rows
+    unsigned long long watermark;
+    unsigned rows;
+    unsigned long long fingerprint;
+    CrimeTable table;
+    // the restauraunts' keys, and every crime near each of them (whatever it costs),
+    // with hit.restauraunt being an index into keys
+    std::vector<std::string> keys;
+    std::vector<CrimeHit> hits;
+};
+
+#endif
@@ -0,0 +1,138 @@
+/******************************************************************************
+ * CrimeTable.cpp                                                             *
+ *                                                                            *
+ * Every crime read, stored a column at a time.                               *
+ ******************************************************************************/
+
+#include "CrimeTable.h"
+
+#include <climits>
+#include <cfloat>
+
+using namespace std;
+
+// how many crimes select() and count() test at a time
+#define FILTER_BLOCK 256
+
+CrimeFilter::CrimeFilter(){
+    firstDay = INT_MIN;
+    lastDay = INT_MAX;
+    minX = minY = -DBL_MAX;
+    maxX = maxY = DBL_MAX;
+    type = -1;
+    weaponMask = weaponValue = 0;
+}
+
+void CrimeTable::clear(){
+    xs.clear(); ys.clear();
+    lats.clear(); lngs.clear();
+    days.clear();
+    types.clear();
+    weapons.clear();
+    rows.clear();
+    incidents.clear();
+}
+
+void CrimeTable::reserve(size_t n){
+    xs.reserve(n); ys.reserve(n);
+    lats.reserve(n); lngs.reserve(n);
+    days.reserve(n);
+    types.reserve(n);
+    weapons.reserve(n);
+    rows.reserve(n);
+    incidents.reserve(n);
+}
+
+unsigned CrimeTable::add(const Location& metric, const Location& latLng, const Date& date,
+                         unsigned char type, unsigned char weapon, unsigned row,
+                         unsigned long long incident){
+    xs.push_back(metric.x);
+    ys.push_back(metric.y);
+    lats.push_back(latLng.x);
+    lngs.push_back(latLng.y);
+    days.push_back(date.epochDay());
+    types.push_back(type);
+    weapons.push_back(weapon);
+    rows.push_back(row);
+    incidents.push_back(incident);
+    return (unsigned)(xs.size() - 1);
+}
+
+void CrimeTable::append(const CrimeTable& other){
+    xs.insert(xs.end(), other.xs.begin(), other.xs.end());
+    ys.insert(ys.end(), other.ys.begin(), other.ys.end());
+    lats.insert(lats.end(), other.lats.begin(), other.lats.end());
+    lngs.insert(lngs.end(), other.lngs.begin(), other.lngs.end());
+    days.insert(days.end(), other.days.begin(), other.days.end());
+    types.insert(types.end(), other.types.begin(), other.types.end());
+    weapons.insert(weapons.end(), other.weapons.begin(), other.weapons.end());
+    rows.insert(rows.end(), other.rows.begin(), other.rows.end());
+    incidents.insert(incidents.end(), other.incidents.begin(), other.incidents.end());
+}
+
+unsigned CrimeTable::append(const CrimeTable& other, size_t i){
+    xs.push_back(other.xs[i]);
+    ys.push_back(other.ys[i]);
+    lats.push_back(other.lats[i]);
+    lngs.push_back(other.lngs[i]);
+    days.push_back(other.days[i]);
+    types.push_back(other.types[i]);
+    weapons.push_back(other.weapons[i]);
+    rows.push_back(other.rows[i]);
+    incidents.push_back(other.incidents[i]);
+    return (unsigned)(xs.size() - 1);
+}
+
+// Every test is done for every crime (with & rather than &&, so there are no
+// branches), which leaves a loop the compiler can turn into vector instructions. keep
+// is restrict so the compiler knows writing it can't change the columns.
+void CrimeTable::test(const CrimeFilter& f, size_t first, size_t n,
+                      unsigned char* __restrict__ keep) const{
+    const double* x = &xs[first];
+    const double* y = &ys[first];
+    const int* day = &days[first];
+    const unsigned char* type = &types[first];
+    const unsigned char* weapon = &weapons[first];
+    bool anyType = f.type < 0;
+    unsigned char wantedType = (unsigned char)f.type;
+    for(size_t j=0;j<n;j++){
+        keep[j] = (day[j] >= f.firstDay) & (day[j] <= f.lastDay) &
+                  (x[j] >= f.minX) & (x[j] <= f.maxX) &
+                  (y[j] >= f.minY) & (y[j] <= f.maxY) &
+                  (anyType | (type[j] == wantedType)) &
+                  ((weapon[j] & f.weaponMask) == f.weaponValue);
+    }
+}
+
+void CrimeTable::select(const CrimeFilter& filter, vector<unsigned>& out) const{
+    unsigned char keep[FILTER_BLOCK];
+    for(size_t first=0;first<size();first+=FILTER_BLOCK){
+        size_t n = size() - first < FILTER_BLOCK ? size() - first : FILTER_BLOCK;
+        test(filter, first, n, keep);
+        for(size_t j=0;j<n;j++)
+            if(keep[j])
+                out.push_back((unsigned)(first + j));
+    }
+}
+
+size_t CrimeTable::count(const CrimeFilter& filter) const{
+    unsigned char keep[FILTER_BLOCK];
+    size_t total = 0;
+    for(size_t first=0;first<size();first+=FILTER_BLOCK){
+        size_t n = size() - first < FILTER_BLOCK ? size() - first : FILTER_BLOCK;
+        test(filter, first, n, keep);
+        for(size_t j=0;j<n;j++)
+            total += keep[j];
+    }
+    return total;
+}
+
+// Crime.csv has the header "Location, Date, Type, Danger", where the danger is the
+// weapon flags
+void CrimeTable::write(ostream& out, size_t first, size_t last) const{
+    for(size_t i=first;i<last;i++){
+        Location l = latLng(i);
+        out << '"' << l << "\", " << date(i) << ", "
+            << int(types[i]) << ", " << int(weapons[i]) << '\n';
+    }
+}
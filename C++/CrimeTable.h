@@ -0,0 +1,84 @@
+/******************************************************************************
+ * CrimeTable.h                                                               *
+ *                                                                            *
+ * Every crime read, stored a column at a time: one contiguous array each for *
+ * the metric x and y, the latitude and longitude, the day (counted from      *
+ * 1/1/1970), the incident type, the weapon flags, the row of the crime file  *
+ * it came from, and its incident number (COMPNOS, see IncidentSet.h). Crime  *
+ * i is the i'th entry of every column, and is referred to everywhere else by *
+ * that index alone.                                                          *
+ *                                                                            *
+ * This is the one copy of the crimes in memory: the join reads the x and y   *
+ * columns, the scoring reads the days, types and weapons, and Crime.csv is   *
+ * written from it. A question like "every firearm incident since 2013 in     *
+ * this box" only has to read the columns it asks about, which the compiler   *
+ * can check several crimes at a time.                                        *
+ ******************************************************************************/
+
+#ifndef CRIME_TABLE
+#define CRIME_TABLE
+
+#include <ostream>
+#include <vector>
+
+#include "Date.h"
+#include "Location.h"
+
+// Which crimes select() should pick out. Everything passes by default; set whichever
+// of the fields should narrow it down
+struct CrimeFilter{
+    CrimeFilter();
+
+    // between these days (inclusive), see Date::epochDay
+    int firstDay, lastDay;
+    // within this box, in meters
+    double minX, maxX, minY, maxY;
+    // of this incident type, or of any if negative
+    int type;
+    // with weapon & weaponMask == weaponValue; firearms, say, would be WEAPON_FLAG and 3
+    unsigned char weaponMask, weaponValue;
+};
+
+class CrimeTable{
+public:
+    size_t size() const { return xs.size(); }
+    bool empty() const { return xs.empty(); }
+    void clear();
+    void reserve(size_t n);
+
+    // adds a crime to the end of the table, returning its index
+    unsigned add(const Location& metric, const Location& latLng, const Date& date,
+                 unsigned char type, unsigned char weapon, unsigned row,
+                 unsigned long long incident);
+    // adds every crime in other to the end of the table
+    void append(const CrimeTable& other);
+    // adds crime i of other to the end of the table, returning its index here
+    unsigned append(const CrimeTable& other, size_t i);
+
+    Location metric(size_t i) const { return Location(xs[i], ys[i]); }
+    Location latLng(size_t i) const { return Location(lats[i], lngs[i]); }
+    Date date(size_t i) const { return Date::fromEpochDay(days[i]); }
+
+    // appends the indices of the crimes that pass the filter to out, in order
+    void select(const CrimeFilter& filter, std::vector<unsigned>& out) const;
+    // how many crimes pass the filter
+    size_t count(const CrimeFilter& filter) const;
+
+    // writes crimes [first, last) as rows of Crime.csv
+    void write(std::ostream& out, size_t first, size_t last) const;
+
+    // the columns
+    std::vector<double> xs, ys;
+    std::vector<double> lats, lngs;
+    std::vector<int> days;
+    std::vector<unsigned char> types;
+    std::vector<unsigned char> weapons;
+    std::vector<unsigned> rows;
+    std::vector<unsigned long long> incidents;
+
+private:
+    // sets keep[j] for each of the n crimes from first on
+    void test(const CrimeFilter& filter, size_t first, size_t n, unsigned char* keep) const;
+};
+
+#endif
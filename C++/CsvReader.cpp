@@ -0,0 +1,176 @@
+/******************************************************************************
+ * CsvReader.cpp                                                              *
+ *                                                                            *
+ * Splits the blocks handed out by an InputFile into rows, and the rows into  *
+ * Fields pointing straight into the block, so reading a cell never involves  *
+ * copying it anywhere. The block is scanned 64 bytes at a go, turning it     *
+ * into bitmasks of unquoted commas and newlines.                             *
+ ******************************************************************************/
+
+#include "CsvReader.h"
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+CsvReader::CsvReader(const char* path) : file(path){
+    cursor = blockEnd = NULL;
+    done = !file.isOpen();
+    startBlock(NULL, NULL);
+}
+
+CsvReader::CsvReader(const char* begin, const char* end){
+    done = false;
+    startBlock(begin, end);
+}
+
+bool CsvReader::isOpen(){
+    return file.isOpen();
+}
+
+bool CsvReader::eof(){
+    return done;
+}
+
+bool CsvReader::readRow(){
+    while(!done){
+        if(cursor >= blockEnd){
+            const char* begin;
+            const char* end;
+            if(!file.nextBlock(begin, end)){
+                done = true;
+                fields.clear();
+                return false;
+            }
+            startBlock(begin, end);
+            continue;
+        }
+        if(splitRow())
+            return true;
+    }
+    return false;
+}
+
+void CsvReader::skipRow(){
+    readRow();
+}
+
+void CsvReader::startBlock(const char* begin, const char* end){
+    cursor = scanPos = begin;
+    blockEnd = end;
+    inQuotes = 0;
+    separators = 0;
+    separatorBase = begin;
+}
+
+// Returns a mask with a bit set for every byte of the 64 at p equal to c
+#ifdef __SSE2__
+static inline uint64_t matchMask(const __m128i chunk[4], char c){
+    __m128i needle = _mm_set1_epi8(c);
+    uint64_t m0 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[0], needle));
+    uint64_t m1 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[1], needle));
+    uint64_t m2 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[2], needle));
+    uint64_t m3 = (uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk[3], needle));
+    return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+#else
+static inline uint64_t matchMask(const char* p, char c){
+    uint64_t m = 0;
+    for(int i=0;i<64;i++)
+        m |= (uint64_t)(p[i] == c) << i;
+    return m;
+}
+#endif
+
+// Turns a mask of quote characters into a mask of the bytes between them: bit i of
+// the result is the xor of bits 0 through i. A doubled "" toggles twice, so it
+// correctly leaves the cell quoted.
+static inline uint64_t prefixXor(uint64_t x){
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+void CsvReader::scanChunk(){
+    const char* p = scanPos;
+    // The last few bytes of the block are copied somewhere safe to read 64 bytes of,
+    // padded out with zeros, which match nothing
+    char tail[64];
+    if(blockEnd - scanPos < 64){
+        memset(tail, 0, sizeof(tail));
+        memcpy(tail, scanPos, blockEnd - scanPos);
+        p = tail;
+    }
+#ifdef __SSE2__
+    __m128i chunk[4];
+    for(int i=0;i<4;i++)
+        chunk[i] = _mm_loadu_si128((const __m128i*)(p + 16*i));
+#else
+    const char* chunk = p;
+#endif
+    uint64_t quotes   = matchMask(chunk, '"');
+    uint64_t commas   = matchMask(chunk, ',');
+    uint64_t newlines = matchMask(chunk, '\n');
+
+    uint64_t quoted = prefixXor(quotes) ^ inQuotes;
+    // carry the state of the last byte over into the next chunk
+    inQuotes = (uint64_t)0 - (quoted >> 63);
+
+    separators = (commas | newlines) & ~quoted;
+    separatorBase = scanPos;
+    scanPos += 64;
+}
+
+const char* CsvReader::nextSeparator(){
+    while(separators == 0){
+        if(scanPos >= blockEnd)
+            return NULL;
+        scanChunk();
+    }
+    const char* sep = separatorBase + __builtin_ctzll(separators);
+    separators &= separators - 1;
+    return sep;
+}
+
+// strips the trailing '\r' of a windows line ending and the quotes of a quoted cell
+void CsvReader::addField(const char* start, const char* end){
+    if(end > start && end[-1] == '\r')
+        end--;
+    if(end - start >= 2 && *start == '"' && end[-1] == '"'){
+        start++;
+        end--;
+    }
+    fields.push_back(Field(start, end));
+}
+
+// Splits the row starting at cursor, leaving cursor at the start of the next row.
+// Blank lines are skipped, in which case this returns false.
+bool CsvReader::splitRow(){
+    fields.clear();
+    const char* start = cursor;
+    while(true){
+        const char* sep = nextSeparator();
+        if(sep == NULL){
+            // The last row of a file without a final newline
+            cursor = blockEnd;
+            if(start == blockEnd && fields.empty())
+                return false;
+            addField(start, blockEnd);
+            return true;
+        }
+        addField(start, sep);
+        start = sep + 1;
+        if(*sep == '\n'){
+            cursor = start;
+            if(fields.size() == 1 && fields[0].empty())
+                return false;
+            return true;
+        }
+    }
+}
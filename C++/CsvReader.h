@@ -0,0 +1,72 @@
+/******************************************************************************
+ * CsvReader.h                                                                *
+ *                                                                            *
+ * Splits the blocks handed out by an InputFile into rows, and the rows into  *
+ * Fields pointing straight into the block, so reading a cell never involves  *
+ * copying it anywhere. Quoted cells have their quotes stripped, and commas   *
+ * and newlines within them are left alone (doubled "" escapes inside a cell  *
+ * are left as they are, as unescaping them would need a copy).               *
+ *                                                                            *
+ * Rather than looking at one character at a time, the block is scanned 64    *
+ * bytes at a go with SSE2: the quotes, commas and newlines in each chunk are *
+ * turned into bitmasks, a prefix xor of the quote mask marks which bytes are *
+ * inside quotes, and what is left is a mask of the commas and newlines that  *
+ * actually split cells. Rows are then cut from those positions alone.        *
+ ******************************************************************************/
+
+#ifndef CSV_READER
+#define CSV_READER
+
+#include <stdint.h>
+#include <vector>
+
+#include "Field.h"
+#include "InputFile.h"
+
+class CsvReader{
+public:
+    // reads the file at path
+    CsvReader(const char* path);
+    // reads the rows in [begin, end), which must start at the start of a row
+    CsvReader(const char* begin, const char* end);
+
+    bool isOpen();
+
+    // reads the next row into the fields, returning false at the end of the file
+    bool readRow();
+
+    // skips a row, like the header
+    void skipRow();
+
+    // true once readRow has run out of rows
+    bool eof();
+
+    // the fields of the last row read
+    size_t size() const { return fields.size(); }
+    const Field& operator[](size_t i) const { return fields[i]; }
+
+private:
+    bool splitRow();
+    void startBlock(const char* begin, const char* end);
+    void addField(const char* start, const char* end);
+
+    // returns the next comma or newline that isn't quoted, or NULL at the end of the block
+    const char* nextSeparator();
+    // finds the separators in the next 64 bytes of the block
+    void scanChunk();
+
+    InputFile file;
+    const char* cursor;
+    const char* blockEnd;
+    bool done;
+    std::vector<Field> fields;
+
+    // where the next chunk starts, and whether it starts within quotes
+    const char* scanPos;
+    uint64_t inQuotes;
+    // the separators found in the last chunk scanned
+    uint64_t separators;
+    const char* separatorBase;
+};
+
+#endif
@@ -4,76 +4,129 @@
  * Nolan Hawkins, April 2015                                                  *
  *                                                                            *
  * A simple date class to hold the month, day, and year, with overloaded      *
- * operators for determining the most recent date and the (rather approximate,*
- * overlooking leap years and the fact that not every month actually has      *
- * 30.4 days) difference in days between 2 dates.                             *
+ * operators for determining the most recent date and the difference in days  *
+ * between 2 dates, all kept as a single number of days since 1/1/1970.       *
  ******************************************************************************/
 
 #include "Date.h"
 
+#include <ctime>
+
+// This is Howard Hinnant's days_from_civil, which counts in 400 year eras (each exactly
+// 146097 days long) of years starting in March, so that the leap day falls at the very
+// end of the year; it is exact for any date, with no loops and no tables
+static inline int daysFromCivil(int month, int day, int year){
+    int y = year - (month <= 2);
+    int era = (y >= 0 ? y : y - 399)/400;
+    int yearOfEra = y - era*400;
+    int dayOfYear = (153*(month > 2 ? month - 3 : month + 9) + 2)/5 + day - 1;
+    int dayOfEra = yearOfEra*365 + yearOfEra/4 - yearOfEra/100 + dayOfYear;
+    return era*146097 + dayOfEra - 719468;
+}
+
+// Whether a month, day and year make sense, roughly: the days of every month are let
+// run to 31, and daysFromCivil carries the extra days into the next month
+static inline bool validCivil(int month, int day, int year){
+    return month >= 1 && month <= 12 && day >= 1 && day <= 31 && year > 0 && year <= MAX_YEAR;
+}
+
 Date::Date(){
-    month = 0;
-    day   = 0;
-    year  = 0;
+    days = 0;
 }
 
 Date::Date(int month, int day, int year){
-    this->month = (unsigned char)month;
-    this->day   = (unsigned char)day;
-    this->year  = (short)year;
+    days = daysFromCivil(month, day, year);
 }
 
 // parse Date from string
 Date::Date(char* s){
-    sscanf(s, "%hhu/%hhu/%hd", &month, &day, &year);
+    setDate(s);
 }
 
 void Date::setDate(char* s){
-    sscanf(s, "%hhu/%hhu/%hd", &month, &day, &year);
+    int month = 0, day = 0, year = 0;
+    if(sscanf(s, "%d/%d/%d", &month, &day, &year) == 3 && validCivil(month, day, year))
+        days = daysFromCivil(month, day, year);
+    else
+        days = INVALID_DAY;
 }
 
-// return a date representation of the current day
-Date Date::now(){
-    time_t now = time(0);
-    tm *t = gmtime(&now);
-    return Date(t->tm_mon, t->tm_mday, t->tm_year+1900);
+// returns true if c is a digit
+static inline bool isDigit(char c){
+    return (unsigned)(c - '0') < 10;
 }
 
-// date a is > date b if b occured before a
-bool operator>(const Date& a, const Date& b){
-    if(a.year < b.year)
-        return false;
-    if(a.year > b.year)
-        return true;
-    if(a.month < b.month)
-        return false;
-    if(a.month > b.month)
-        return true;
-    if(a.day > b.day)
-        return true;
-    return false;
+// sscanf would want a null terminated string, and would happily strlen its way through
+// the rest of a mapped file to find one, so fields are parsed by hand
+void Date::setDate(const Field& f){
+    const char* p = f.begin;
+    // Both files always write dates zero padded as mm/dd/yyyy, so that gets a fast path
+    // with no loops and no branches beyond checking the shape
+    if(f.size() >= 10 && p[2] == '/' && p[5] == '/' &&
+       isDigit(p[0]) && isDigit(p[1]) && isDigit(p[3]) && isDigit(p[4]) &&
+       isDigit(p[6]) && isDigit(p[7]) && isDigit(p[8]) && isDigit(p[9])){
+        int month = (p[0] - '0')*10 + (p[1] - '0');
+        int day = (p[3] - '0')*10 + (p[4] - '0');
+        int year = (p[6] - '0')*1000 + (p[7] - '0')*100 + (p[8] - '0')*10 + (p[9] - '0');
+        days = validCivil(month, day, year) ? daysFromCivil(month, day, year) : INVALID_DAY;
+        return;
+    }
+    // Otherwise there have to be three numbers, separated by slashes
+    int parts[3] = {0, 0, 0};
+    int read = 0;
+    for(int i=0;i<3;i++){
+        const char* start = p;
+        while(p < f.end && *p >= '0' && *p <= '9' && p - start < 9){
+            parts[i] = parts[i]*10 + (*p - '0');
+            p++;
+        }
+        if(p == start)
+            break;
+        read++;
+        if(i < 2 && p < f.end && *p == '/')
+            p++;
+        else
+            break;
+    }
+    if(read == 3 && validCivil(parts[0], parts[1], parts[2]))
+        days = daysFromCivil(parts[0], parts[1], parts[2]);
+    else
+        days = INVALID_DAY;
 }
-bool operator<(const Date& b, const Date& a){
-    if(a.year < b.year)
-        return false;
-    if(a.year > b.year)
-        return true;
-    if(a.month < b.month)
-        return false;
-    if(a.month > b.month)
-        return true;
-    if(a.day > b.day)
-        return true;
-    return false;
+
+// return a date representation of the current day. Every day since 1/1/1970 has been
+// exactly 86400 seconds long as far as time() is concerned, so there is no need to go
+// through gmtime (whose tm_mon counts from 0, which this once forgot)
+Date Date::now(){
+    return fromEpochDay((int)(time(0)/86400));
 }
 
-//returns approximate difference in days
-int operator-(const Date& a,const Date& b){
-    return (int)((a.year-b.year)*365.25 + (a.month-b.month)*30.4 + (a.day-b.day));
+Date Date::fromEpochDay(int days){
+    Date d;
+    d.days = days;
+    return d;
 }
 
-// ouputs date to stream in the form of  mm/dd/yyyy
+// And this is Hinnant's civil_from_days, undoing daysFromCivil
+void Date::civil(int& month, int& day, int& year) const{
+    int z = days + 719468;
+    int era = (z >= 0 ? z : z - 146096)/146097;
+    int dayOfEra = z - era*146097;
+    int yearOfEra = (dayOfEra - dayOfEra/1460 + dayOfEra/36524 - dayOfEra/146096)/365;
+    int dayOfYear = dayOfEra - (365*yearOfEra + yearOfEra/4 - yearOfEra/100);
+    int monthIndex = (5*dayOfYear + 2)/153;
+    day   = dayOfYear - (153*monthIndex + 2)/5 + 1;
+    month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+    year  = yearOfEra + era*400 + (month <= 2);
+}
+
+// ouputs date to stream in the form of  mm/dd/yyyy, leaving the cell empty if the date
+// couldn't be read in the first place
 std::ostream &operator<<(std::ostream  &output, const Date& date){
-    output << int(date.month) << '/' << int(date.day) << '/' << date.year;
+    if(!date.valid())
+        return output;
+    int month, day, year;
+    date.civil(month, day, year);
+    output << month << '/' << day << '/' << year;
     return output;
-}
\ No newline at end of file
+}
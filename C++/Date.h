@@ -4,17 +4,31 @@
  * Nolan Hawkins, April 2015                                                  *
  *                                                                            *
  * A simple date class to hold the month, day, and year, with overloaded      *
- * operators for determining the most recent date and the (rather approximate,*
- * overlooking leap years and the fact that not every month actually has      *
- * 30.4 days) difference in days between 2 dates.                             *
+ * operators for determining the most recent date and the difference in days  *
+ * between 2 dates.                                                           *
+ *                                                                            *
+ * It is actually stored as a single number of days since 1/1/1970, worked   *
+ * out exactly (leap years and all) when the date is read, so comparing two   *
+ * dates or taking their difference is one integer operation, and the month, *
+ * day and year are only worked out again when the date is written out.      *
  ******************************************************************************/
 
 #ifndef DATE
 #define DATE
 
+#include <climits>
 #include <cstdio>
 #include <ostream>
 
+#include "Field.h"
+
+// The day number of a date that couldn't be read (an empty or malformed field). It is
+// never a real day, and everything that works with days should check valid() first
+#define INVALID_DAY INT_MIN
+
+// the last year a date can be read in; any later and its day wouldn't fit in an int
+#define MAX_YEAR 9999
+
 class Date{
 public:
     Date();
@@ -23,23 +37,33 @@ public:
     Date(char* s);
     // parse Date from string
     void setDate(char* s);
+    // parse Date from a field in the form of mm/dd/yyyy (anything after is ignored)
+    void setDate(const Field& f);
+    // false if the date couldn't be read, in which case its day is INVALID_DAY
+    bool valid() const { return days != INVALID_DAY; }
     
     // return a date representation of the current day
     static Date now();
     
+    // the number of days since 1/1/1970, and the date that many days after 1/1/1970
+    int epochDay() const { return days; }
+    static Date fromEpochDay(int days);
+    
+    // the month (1 to 12), day and year, worked out from the day number
+    void civil(int& month, int& day, int& year) const;
+    
     // date a is > date b if b occured before a
-    friend bool operator>(const Date& a, const Date& b);
-    friend bool operator<(const Date& a, const Date& b);
+    friend bool operator>(const Date& a, const Date& b) { return a.days > b.days; }
+    friend bool operator<(const Date& a, const Date& b) { return a.days < b.days; }
     
-    //returns approximate difference in days
-    friend int operator-(const Date& a, const Date& b);
+    //returns the difference in days
+    friend int operator-(const Date& a, const Date& b) { return a.days - b.days; }
     
-    // ouputs date to stream in the form of  mm/dd/yyyy
+    // ouputs date to stream in the form of  mm/dd/yyyy (or nothing, if it isn't valid)
     friend std::ostream &operator<<(std::ostream  &output, const Date& d);
         
-    // the actual data, contrived to fit in 4 bytes, hopefully
-    unsigned char month, day;
-    short year;
+    // the actual data, which fits in 4 bytes for certain now
+    int days;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+/******************************************************************************
+ * DistanceKernel.cpp                                                         *
+ *                                                                            *
+ * The versions of the distance filter, and the choice between them. The     *
+ * AVX2 version is compiled for AVX2 whatever the flags given to the compiler *
+ * (with a target attribute), but only ever called if the processor running  *
+ * the program says it supports it.                                           *
+ ******************************************************************************/
+
+#include "DistanceKernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// one candidate at a time, for whatever is left at the end of a block and for
+// processors without anything better
+static unsigned long long scalarMask(const double* xs, const double* ys, size_t from,
+                                     size_t n, const Location& l, double r2){
+    unsigned long long mask = 0;
+    for(size_t i=from;i<n;i++){
+        double dx = xs[i] - l.x;
+        double dy = ys[i] - l.y;
+        if(dx*dx + dy*dy < r2)
+            mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+static unsigned long long scalarKernel(const double* xs, const double* ys, size_t n,
+                                       const Location& l, double r2){
+    return scalarMask(xs, ys, 0, n, l, r2);
+}
+
+#ifdef HAVE_X86_KERNELS
+
+// two candidates at a time
+__attribute__((target("sse2")))
+static unsigned long long sse2Kernel(const double* xs, const double* ys, size_t n,
+                                     const Location& l, double r2){
+    __m128d x = _mm_set1_pd(l.x);
+    __m128d y = _mm_set1_pd(l.y);
+    __m128d r = _mm_set1_pd(r2);
+    unsigned long long mask = 0;
+    size_t i = 0;
+    for(;i+2<=n;i+=2){
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(xs + i), x);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(ys + i), y);
+        __m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+        mask |= (unsigned long long)_mm_movemask_pd(_mm_cmplt_pd(d2, r)) << i;
+    }
+    return mask | scalarMask(xs, ys, i, n, l, r2);
+}
+
+// four candidates at a time
+__attribute__((target("avx2")))
+static unsigned long long avx2Kernel(const double* xs, const double* ys, size_t n,
+                                     const Location& l, double r2){
+    __m256d x = _mm256_set1_pd(l.x);
+    __m256d y = _mm256_set1_pd(l.y);
+    __m256d r = _mm256_set1_pd(r2);
+    unsigned long long mask = 0;
+    size_t i = 0;
+    for(;i+4<=n;i+=4){
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs + i), x);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys + i), y);
+        __m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+        mask |= (unsigned long long)
+                _mm256_movemask_pd(_mm256_cmp_pd(d2, r, _CMP_LT_OQ)) << i;
+    }
+    return mask | scalarMask(xs, ys, i, n, l, r2);
+}
+
+#endif
+
+typedef unsigned long long (*DistanceKernel)(const double*, const double*, size_t,
+                                             const Location&, double);
+
+struct KernelChoice{
+    DistanceKernel kernel;
+    const char* name;
+};
+
+static KernelChoice chooseKernel(){
+    KernelChoice choice = {scalarKernel, "scalar"};
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        choice.kernel = avx2Kernel;
+        choice.name = "avx2";
+    }else if(__builtin_cpu_supports("sse2")){
+        choice.kernel = sse2Kernel;
+        choice.name = "sse2";
+    }
+#endif
+    return choice;
+}
+
+static const KernelChoice chosen = chooseKernel();
+
+unsigned long long distanceMask(const double* xs, const double* ys, size_t n,
+                                const Location& l, double r2){
+    return chosen.kernel(xs, ys, n, l, r2);
+}
+
+const char* distanceKernelName(){
+    return chosen.name;
+}
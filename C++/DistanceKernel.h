@@ -0,0 +1,32 @@
+/******************************************************************************
+ * DistanceKernel.h                                                           *
+ *                                                                            *
+ * The innermost loop of the whole analysis: given a block of candidate       *
+ * coordinates (a k-d tree leaf, or a grid cell), which of them are within    *
+ * the radius of a crime? This answers that several candidates at a time,    *
+ * with AVX2 where the processor has it (checked once, when the program      *
+ * starts), SSE2 otherwise, and plain C++ anywhere else.                      *
+ *                                                                            *
+ * Every version computes exactly dx*dx + dy*dy < r2 (no fused multiply-add), *
+ * so which one runs never changes the answer.                                *
+ ******************************************************************************/
+
+#ifndef DISTANCE_KERNEL
+#define DISTANCE_KERNEL
+
+#include <cstddef>
+
+#include "Location.h"
+
+// the most candidates distanceMask takes at a time
+#define DISTANCE_BLOCK 64
+
+// Returns a mask with bit i set if (xs[i], ys[i]) is strictly within sqrt(r2) of l,
+// for the n (at most DISTANCE_BLOCK) candidates at xs and ys
+unsigned long long distanceMask(const double* xs, const double* ys, size_t n,
+                                const Location& l, double r2);
+
+// the name of the version of distanceMask in use: "avx2", "sse2" or "scalar"
+const char* distanceKernelName();
+
+#endif
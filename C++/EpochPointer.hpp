@@ -0,0 +1,80 @@
+/******************************************************************************
+ * EpochPointer.hpp                                                           *
+ *                                                                            *
+ * A pointer to an object that readers use without ever taking a lock, while  *
+ * a writer now and then swaps in a new object and frees the old one once no  *
+ * reader can still be looking at it (epoch based reclamation, a poor man's   *
+ * RCU).                                                                      *
+ *                                                                            *
+ * There is a global epoch, and every reader has a slot of its own. To read,  *
+ * a reader writes the current epoch into its slot (pinning it) and then      *
+ * loads the pointer; when it is done it puts 0 back. To replace the object,  *
+ * the writer swaps the pointer, moves the epoch on, and then waits until     *
+ * every slot is either 0 or pinned at the new epoch, since any reader that   *
+ * pinned before then might have the old pointer and any that pinned after    *
+ * can't. Only then is the old object deleted. Readers never wait for         *
+ * anything; the writer (a background thread, normally) does all the waiting. *
+ *                                                                            *
+ * Every reader needs its own slot, numbered from 0, and a reader mustn't pin *
+ * its slot again while it still has it pinned. There should only be one      *
+ * writer at a time.                                                          *
+ ******************************************************************************/
+
+#ifndef EPOCH_POINTER
+#define EPOCH_POINTER
+
+#include <atomic>
+#include <cstddef>
+
+template<class T>
+class EpochPointer{
+public:
+    // readers is how many reader slots there are. The pointer starts out as initial
+    // (which it now owns)
+    EpochPointer(size_t readers, T* initial = NULL);
+    // deletes the current object (there must be no readers left by now)
+   ~EpochPointer();
+
+    // Pins reader's slot for as long as it is around, with the object that was
+    // current when it was made
+    class Guard{
+    public:
+        Guard(EpochPointer& pointer, size_t reader);
+       ~Guard();
+        T* get() const { return object; }
+        T* operator->() const { return object; }
+        T& operator*() const { return *object; }
+    private:
+        Guard(const Guard&);
+        Guard& operator=(const Guard&);
+        std::atomic<unsigned long long>& slot;
+        T* object;
+    };
+
+    // makes next the current object, then waits for every reader that could still
+    // be reading the old one to finish before deleting it
+    void publish(T* next);
+
+    // how many times publish has been called
+    unsigned long long generation() const { return epoch.load() - 1; }
+
+private:
+    EpochPointer(const EpochPointer&);
+    EpochPointer& operator=(const EpochPointer&);
+
+    // each slot padded out to a cache line, as every read writes to one (padded
+    // rather than aligned, since new won't align to more than 16 bytes before C++17)
+    struct Slot{
+        std::atomic<unsigned long long> pinned;
+        char padding[64 - sizeof(std::atomic<unsigned long long>)];
+    };
+
+    std::atomic<T*> current;
+    std::atomic<unsigned long long> epoch;
+    Slot* slots;
+    size_t readers;
+};
+
+#include "EpochPointer.tpp"
+
+#endif
@@ -0,0 +1,53 @@
+/******************************************************************************
+ * EpochPointer.tpp                                                           *
+ *                                                                            *
+ * A pointer swapped without blocking its readers, with the objects it used   *
+ * to point at freed once the readers are done with them.                     *
+ ******************************************************************************/
+
+#include <thread>
+
+// Everything here uses the default (sequentially consistent) ordering, which is what
+// makes it work: if the writer doesn't see a reader's pin, the reader's load of the
+// pointer comes after the writer's swap, so it gets the new object
+
+template<class T>
+EpochPointer<T>::EpochPointer(size_t readers, T* initial)
+    : current(initial), epoch(1), readers(readers){
+    slots = new Slot[readers];
+    for(size_t i=0;i<readers;i++)
+        slots[i].pinned = 0;
+}
+
+template<class T>
+EpochPointer<T>::~EpochPointer(){
+    delete current.load();
+    delete[] slots;
+}
+
+template<class T>
+EpochPointer<T>::Guard::Guard(EpochPointer& pointer, size_t reader)
+    : slot(pointer.slots[reader].pinned){
+    slot = pointer.epoch.load();
+    object = pointer.current.load();
+}
+
+template<class T>
+EpochPointer<T>::Guard::~Guard(){
+    slot = 0;
+}
+
+template<class T>
+void EpochPointer<T>::publish(T* next){
+    T* old = current.exchange(next);
+    unsigned long long now = epoch.fetch_add(1) + 1;
+    for(size_t i=0;i<readers;i++){
+        while(true){
+            unsigned long long pinned = slots[i].pinned.load();
+            if(pinned == 0 || pinned >= now)
+                break;
+            std::this_thread::yield();
+        }
+    }
+    delete old;
+}
@@ -0,0 +1,37 @@
+/******************************************************************************
+ * Field.h                                                                    *
+ *                                                                            *
+ * A Field is a slice of a larger buffer (usually a memory mapped CSV file),  *
+ * described by a pointer to its first character and one past its last. It   *
+ * is basically a poor man's string_view: nothing is copied until somebody    *
+ * actually asks for a std::string.                                           *
+ ******************************************************************************/
+
+#ifndef FIELD
+#define FIELD
+
+#include <cstring>
+#include <string>
+
+struct Field{
+    const char* begin;
+    const char* end;
+
+    Field() : begin(NULL), end(NULL) {}
+    Field(const char* b, const char* e) : begin(b), end(e) {}
+
+    size_t size() const { return end - begin; }
+    bool empty() const { return begin == end; }
+    char operator[](size_t i) const { return begin[i]; }
+
+    // true if the field holds exactly the characters of s
+    bool equals(const char* s) const {
+        size_t n = strlen(s);
+        return n == size() && memcmp(begin, s, n) == 0;
+    }
+
+    // the only place a copy is made
+    std::string str() const { return std::string(begin, end); }
+};
+
+#endif
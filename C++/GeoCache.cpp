@@ -0,0 +1,128 @@
+/******************************************************************************
+ * GeoCache.cpp                                                               *
+ *                                                                            *
+ * The geocoded locations of addresses, looked up straight from a mapping of  *
+ * the file python/locationFinder.py writes.                                  *
+ ******************************************************************************/
+
+#include "GeoCache.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// the first 8 bytes of the file
+static const char MAGIC[8] = {'G', 'E', 'O', 'C', 'A', 'C', 'H', 'E'};
+// and the rest of the header: the version, number of addresses and number of buckets
+#define GEO_CACHE_HEADER 20
+
+GeoCache::GeoCache(){
+    map = NULL;
+    mapLength = 0;
+    count = buckets = 0;
+    displacements = NULL;
+    slots = NULL;
+}
+
+GeoCache::~GeoCache(){
+    if(map)
+        munmap((void*)map, mapLength);
+}
+
+bool GeoCache::open(const char* path){
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < GEO_CACHE_HEADER){
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED)
+        return false;
+    map = (const char*)mapped;
+    mapLength = st.st_size;
+    unsigned version;
+    memcpy(&version, map + 8, 4);
+    memcpy(&count, map + 12, 4);
+    memcpy(&buckets, map + 16, 4);
+    size_t slotStart = (GEO_CACHE_HEADER + 4*(size_t)buckets + 7)/8*8;
+    if(memcmp(map, MAGIC, sizeof(MAGIC)) != 0 || version != GEO_CACHE_VERSION ||
+       buckets == 0 || slotStart + (size_t)count*sizeof(Slot) > mapLength){
+        count = 0;
+        return false;
+    }
+    displacements = (const int*)(map + GEO_CACHE_HEADER);
+    slots = (const Slot*)(map + slotStart);
+    // every slot's address has to be in the file too
+    for(unsigned i=0;i<count;i++){
+        if(slots[i].offset > mapLength || slots[i].length > mapLength - slots[i].offset){
+            count = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs visit(c) over the characters of [begin, end) as they are once normalized: upper
+// case, with no spaces at either end and runs of spaces in between made one space,
+// exactly as locationFinder.py's normalize() does it
+template<class F>
+static void forEachNormalized(const char* begin, const char* end, F visit){
+    bool started = false, space = false;
+    for(const char* p=begin;p<end;p++){
+        char c = *p;
+        if(c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r'){
+            space = started;
+            continue;
+        }
+        if(space){
+            visit(' ');
+            space = false;
+        }
+        if(c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        visit(c);
+        started = true;
+    }
+}
+
+// FNV-1a, starting from the offset basis xored with seed
+unsigned long long GeoCache::hash(unsigned long long seed, const char* begin, const char* end){
+    unsigned long long h = 14695981039346656037ULL ^ seed;
+    forEachNormalized(begin, end, [&](char c){
+        h ^= (unsigned char)c;
+        h *= 1099511628211ULL;
+    });
+    return h;
+}
+
+bool GeoCache::matches(const Slot& slot, const char* begin, const char* end) const{
+    const char* key = map + slot.offset;
+    size_t at = 0;
+    bool same = true;
+    forEachNormalized(begin, end, [&](char c){
+        same = same && at < slot.length && key[at] == c;
+        at++;
+    });
+    return same && at == slot.length;
+}
+
+bool GeoCache::find(const char* begin, const char* end, Location& latLng) const{
+    if(count == 0)
+        return false;
+    int d = displacements[hash(0, begin, end) % buckets];
+    size_t slot = d < 0 ? (size_t)(-(long long)d - 1) : hash(d, begin, end) % count;
+    if(slot >= count || !matches(slots[slot], begin, end))
+        return false;
+    latLng.x = slots[slot].lat;
+    latLng.y = slots[slot].lng;
+    return true;
+}
@@ -0,0 +1,65 @@
+/******************************************************************************
+ * GeoCache.h                                                                 *
+ *                                                                            *
+ * The locations of the restauraunts the licence file doesn't give one for,   *
+ * worked out from their addresses by python/locationFinder.py and kept in a  *
+ * binary file (see that script for the layout) that is memory mapped here    *
+ * and looked up as it is.                                                    *
+ *                                                                            *
+ * The file is a minimal perfect hash table of the addresses, normalized      *
+ * (upper case, with runs of spaces made one): an address is hashed once to   *
+ * find its bucket, and (unless the bucket only has the one address) once     *
+ * more, with the bucket's seed, to find its slot. The address in the slot is *
+ * then compared with the one looked up, so an address that isn't there is    *
+ * reported as such. The address is normalized a character at a time as it    *
+ * is hashed and compared, so looking one up never allocates anything.        *
+ ******************************************************************************/
+
+#ifndef GEO_CACHE
+#define GEO_CACHE
+
+#include <cstddef>
+
+#include "Location.h"
+
+#define GEO_CACHE_VERSION 1
+
+class GeoCache{
+public:
+    GeoCache();
+   ~GeoCache();
+
+    // maps the cache at path, returning false if there isn't one, or it isn't a cache
+    // of this version, or it is cut short
+    bool open(const char* path);
+
+    // sets latLng to the location of the address [begin, end), returning false if the
+    // address isn't in the cache
+    bool find(const char* begin, const char* end, Location& latLng) const;
+
+    // how many addresses there are
+    size_t size() const { return count; }
+
+private:
+    GeoCache(const GeoCache&);
+    GeoCache& operator=(const GeoCache&);
+
+    // a slot of the table, as it is in the file
+    struct Slot{
+        double lat, lng;
+        unsigned offset, length;
+    };
+
+    // the hash of the normalized address [begin, end), with seed
+    static unsigned long long hash(unsigned long long seed, const char* begin, const char* end);
+    // whether the normalized address [begin, end) is the slot's
+    bool matches(const Slot& slot, const char* begin, const char* end) const;
+
+    const char* map;
+    size_t mapLength;
+    unsigned count, buckets;
+    const int* displacements;
+    const Slot* slots;
+};
+
+#endif
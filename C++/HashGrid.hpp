@@ -0,0 +1,66 @@
+/******************************************************************************
+ * HashGrid.hpp                                                               *
+ *                                                                            *
+ * A spatial hash grid, for when every query has the same radius (and in the  *
+ * crime pass, every query is CRIME_RADIUS). Space is cut into square cells   *
+ * CELL_SIZE meters across, so with a radius of CELL_SIZE everything near a   *
+ * location is in its cell or one of the eight around it, and a query looks   *
+ * at those nine cells and nothing else.                                      *
+ *                                                                            *
+ * Rather than a dense array of cells covering the whole bounding box (which  *
+ * a single restauraunt geocoded to the middle of the ocean would make        *
+ * enormous), the cells are hashed into about as many buckets as there are   *
+ * objects. Once built, the objects sit in flat arrays sorted by bucket, and  *
+ * by cell within a bucket, so every cell's objects are contiguous. Cells     *
+ * sharing a bucket are told apart by a key stored with each object.         *
+ *                                                                            *
+ * CELL_SIZE is a template parameter so the compiler can fold it into the     *
+ * cell arithmetic. Radii bigger than CELL_SIZE still work, just by looking   *
+ * at more cells.                                                             *
+ ******************************************************************************/
+
+#ifndef HASH_GRID
+#define HASH_GRID
+
+#include <vector>
+
+#include "Location.h"
+#include "SpatialIndex.hpp"
+
+template<class T, int CELL_SIZE>
+class HashGrid : public SpatialIndex<T>{
+public:
+    HashGrid();
+
+    // objects are only collected here, until build is called
+    void insert(Location l, T* data);
+    // sorts everything inserted so far into its cell
+    void build();
+
+    // appends every object strictly within radius of l to v
+    void findNodes(const Location& l, int radius, std::vector<T*>& v);
+    std::vector<T*> findNodes(Location l, int radius);
+
+    size_t size();
+    size_t bucketCount();
+
+private:
+    // the cell a coordinate falls in, along one axis
+    static long long cellOf(double c);
+    // the key of a cell, and the bucket it hashes to
+    static unsigned long long cellKey(long long cx, long long cy);
+    size_t bucketOf(unsigned long long key);
+
+    // the objects, sorted by bucket (once built)
+    std::vector<double> xs, ys;
+    std::vector<T*> items;
+    std::vector<unsigned long long> keys;
+
+    // the objects in bucket b are [bucketStart[b], bucketStart[b+1])
+    std::vector<unsigned> bucketStart;
+    size_t mask;
+};
+
+#include "HashGrid.tpp"
+
+#endif
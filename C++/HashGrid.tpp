@@ -0,0 +1,129 @@
+/******************************************************************************
+ * HashGrid.tpp                                                               *
+ *                                                                            *
+ * A spatial hash grid with cells CELL_SIZE meters across, so a query with a  *
+ * radius of CELL_SIZE only ever looks at a 3x3 block of cells.               *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+
+#include "DistanceKernel.h"
+
+template<class T, int CELL_SIZE>
+HashGrid<T, CELL_SIZE>::HashGrid(){
+    mask = 0;
+    bucketStart.assign(2, 0);
+}
+
+template<class T, int CELL_SIZE>
+void HashGrid<T, CELL_SIZE>::insert(Location l, T* data){
+    xs.push_back(l.x);
+    ys.push_back(l.y);
+    items.push_back(data);
+}
+
+template<class T, int CELL_SIZE>
+size_t HashGrid<T, CELL_SIZE>::size(){
+    return items.size();
+}
+
+template<class T, int CELL_SIZE>
+size_t HashGrid<T, CELL_SIZE>::bucketCount(){
+    return mask + 1;
+}
+
+template<class T, int CELL_SIZE>
+long long HashGrid<T, CELL_SIZE>::cellOf(double c){
+    return (long long)std::floor(c / CELL_SIZE);
+}
+
+template<class T, int CELL_SIZE>
+unsigned long long HashGrid<T, CELL_SIZE>::cellKey(long long cx, long long cy){
+    return ((unsigned long long)(unsigned)cx << 32) | (unsigned)cy;
+}
+
+// A multiplicative hash of the key, taking the well mixed high bits
+template<class T, int CELL_SIZE>
+size_t HashGrid<T, CELL_SIZE>::bucketOf(unsigned long long key){
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+// A counting sort of the objects into their buckets, and then a sort by key within
+// each bucket so that each cell is contiguous
+template<class T, int CELL_SIZE>
+void HashGrid<T, CELL_SIZE>::build(){
+    size_t n = items.size();
+    size_t buckets = 1;
+    while(buckets < n)
+        buckets *= 2;
+    mask = buckets - 1;
+
+    keys.resize(n);
+    std::vector<size_t> bucket(n);
+    bucketStart.assign(buckets + 1, 0);
+    for(size_t i=0;i<n;i++){
+        keys[i] = cellKey(cellOf(xs[i]), cellOf(ys[i]));
+        bucket[i] = bucketOf(keys[i]);
+        bucketStart[bucket[i] + 1]++;
+    }
+    for(size_t b=0;b<buckets;b++)
+        bucketStart[b + 1] += bucketStart[b];
+
+    std::vector<size_t> order(n);
+    std::vector<unsigned> next(bucketStart.begin(), bucketStart.end() - 1);
+    for(size_t i=0;i<n;i++)
+        order[next[bucket[i]]++] = i;
+    for(size_t b=0;b<buckets;b++){
+        std::sort(order.begin() + bucketStart[b], order.begin() + bucketStart[b + 1],
+                  [&](size_t a, size_t c){ return keys[a] < keys[c]; });
+    }
+
+    std::vector<double> oldXs(xs), oldYs(ys);
+    std::vector<T*> oldItems(items);
+    std::vector<unsigned long long> oldKeys(keys);
+    for(size_t i=0;i<n;i++){
+        xs[i] = oldXs[order[i]];
+        ys[i] = oldYs[order[i]];
+        items[i] = oldItems[order[i]];
+        keys[i] = oldKeys[order[i]];
+    }
+}
+
+template<class T, int CELL_SIZE>
+std::vector<T*> HashGrid<T, CELL_SIZE>::findNodes(Location l, int radius){
+    std::vector<T*> v;
+    findNodes(l, radius, v);
+    return v;
+}
+
+// Looks at every cell within reach of the radius: the 3x3 block around l's cell when
+// the radius is no more than CELL_SIZE. Anything within the radius of l has to be
+// within the radius along each axis too, so it can't be in any other cell.
+template<class T, int CELL_SIZE>
+void HashGrid<T, CELL_SIZE>::findNodes(const Location& l, int radius, std::vector<T*>& v){
+    double r2 = (double)radius*radius;
+    long long reach = (radius + CELL_SIZE - 1)/CELL_SIZE;
+    long long cx = cellOf(l.x), cy = cellOf(l.y);
+    for(long long x=cx-reach;x<=cx+reach;x++){
+        for(long long y=cy-reach;y<=cy+reach;y++){
+            unsigned long long key = cellKey(x, y);
+            size_t b = bucketOf(key);
+            // the cell is a run of entries within its bucket
+            unsigned first = bucketStart[b], last = bucketStart[b + 1];
+            while(first < last && keys[first] != key)
+                first++;
+            unsigned end = first;
+            while(end < last && keys[end] == key)
+                end++;
+            for(unsigned i=first;i<end;i+=DISTANCE_BLOCK){
+                size_t n = std::min((size_t)(end - i), (size_t)DISTANCE_BLOCK);
+                unsigned long long found = distanceMask(&xs[i], &ys[i], n, l, r2);
+                while(found){
+                    v.push_back(items[i + __builtin_ctzll(found)]);
+                    found &= found - 1;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/******************************************************************************
+ * IncidentSet.cpp                                                            *
+ *                                                                            *
+ * The incidents (COMPNOS numbers) seen so far, and the crime each became.    *
+ ******************************************************************************/
+
+#include "IncidentSet.h"
+
+using namespace std;
+
+// the table starts out with this many slots
+#define INCIDENT_SET_MIN_SLOTS 1024
+
+IncidentSet::IncidentSet(){
+    count = 0;
+    resize(INCIDENT_SET_MIN_SLOTS);
+}
+
+unsigned long long IncidentSet::keyOf(const Field& compnos){
+    if(compnos.empty())
+        return NO_INCIDENT;
+    unsigned long long number = 0;
+    bool digits = compnos.size() <= 18 && (compnos.size() == 1 || *compnos.begin != '0');
+    for(const char* p=compnos.begin;digits && p<compnos.end;p++){
+        if(*p < '0' || *p > '9')
+            digits = false;
+        else
+            number = number*10 + (*p - '0');
+    }
+    if(digits)
+        return number;
+    // FNV-1a, with the top bit set so it can't clash with a plain number (which
+    // are less than 10^18), and the bottom bit clear so it can't be NO_INCIDENT
+    unsigned long long hash = 14695981039346656037ULL;
+    for(const char* p=compnos.begin;p<compnos.end;p++){
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    return (hash | (1ULL << 63)) & ~1ULL;
+}
+
+// A multiplicative hash, taking the top bits
+size_t IncidentSet::slotOf(unsigned long long key) const{
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> shift);
+}
+
+unsigned IncidentSet::insert(unsigned long long key, unsigned crime){
+    if(key == NO_INCIDENT)
+        return crime;
+    // kept at most three quarters full, so probes stay short
+    if((count + 1)*4 > keys.size()*3)
+        resize(keys.size()*2);
+    size_t mask = keys.size() - 1;
+    for(size_t slot=slotOf(key);;slot=(slot + 1) & mask){
+        if(keys[slot] == key)
+            return crimes[slot];
+        if(keys[slot] == NO_INCIDENT){
+            keys[slot] = key;
+            crimes[slot] = crime;
+            count++;
+            return crime;
+        }
+    }
+}
+
+bool IncidentSet::find(unsigned long long key, unsigned& crime) const{
+    if(key == NO_INCIDENT)
+        return false;
+    size_t mask = keys.size() - 1;
+    for(size_t slot=slotOf(key);keys[slot] != NO_INCIDENT;slot=(slot + 1) & mask){
+        if(keys[slot] == key){
+            crime = crimes[slot];
+            return true;
+        }
+    }
+    return false;
+}
+
+void IncidentSet::clear(){
+    count = 0;
+    vector<unsigned long long>().swap(keys);
+    vector<unsigned>().swap(crimes);
+    resize(INCIDENT_SET_MIN_SLOTS);
+}
+
+void IncidentSet::reserve(size_t n){
+    size_t slots = keys.size();
+    while(n*4 > slots*3)
+        slots *= 2;
+    if(slots != keys.size())
+        resize(slots);
+}
+
+// Moves every key into a new table of slots slots (a power of two)
+void IncidentSet::resize(size_t slots){
+    vector<unsigned long long> oldKeys(slots, NO_INCIDENT);
+    vector<unsigned> oldCrimes(slots, 0);
+    oldKeys.swap(keys);
+    oldCrimes.swap(crimes);
+    shift = 64;
+    for(size_t s=slots;s>1;s/=2)
+        shift--;
+    size_t mask = slots - 1;
+    for(size_t i=0;i<oldKeys.size();i++){
+        if(oldKeys[i] == NO_INCIDENT)
+            continue;
+        size_t slot = slotOf(oldKeys[i]);
+        while(keys[slot] != NO_INCIDENT)
+            slot = (slot + 1) & mask;
+        keys[slot] = oldKeys[i];
+        crimes[slot] = oldCrimes[i];
+    }
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * IncidentSet.h                                                              *
+ *                                                                            *
+ * The city's crime export has a row per offense, not per incident, so one    *
+ * incident (one COMPNOS) can show up on several rows, and would otherwise be *
+ * counted against every restauraunt near it several times over. This keeps  *
+ * track of which incidents have been seen already, and which crime each one  *
+ * became, so the rows after the first can be folded into it.                 *
+ *                                                                            *
+ * It is an open addressing hash table (linear probing, a power of two slots) *
+ * of 64 bit keys and 32 bit crime numbers in two flat arrays, 12 bytes a     *
+ * slot, so tens of millions of incidents fit in a few hundred megabytes with *
+ * no allocation per incident.                                                *
+ ******************************************************************************/
+
+#ifndef INCIDENT_SET
+#define INCIDENT_SET
+
+#include <cstddef>
+#include <vector>
+
+#include "Field.h"
+
+// Never a key: it marks the empty slots, and is what a crime without a COMPNOS gets
+#define NO_INCIDENT (~0ULL)
+
+class IncidentSet{
+public:
+    IncidentSet();
+
+    // The key for a COMPNOS: the number itself when it is all digits with no leading
+    // zeros (as it is in every export so far), or a hash of it otherwise, so "0123"
+    // and "123" are different incidents. An empty COMPNOS gets NO_INCIDENT, which is
+    // never stored, so crimes without one are never merged
+    static unsigned long long keyOf(const Field& compnos);
+
+    // If key is already in the set, returns the crime it was stored with; otherwise
+    // stores it with crime, and returns crime
+    unsigned insert(unsigned long long key, unsigned crime);
+    // sets crime to the crime stored with key, returning false if it isn't there
+    bool find(unsigned long long key, unsigned& crime) const;
+
+    size_t size() const { return count; }
+    size_t capacity() const { return keys.size(); }
+    void clear();
+
+    // makes room for n keys without growing again
+    void reserve(size_t n);
+
+private:
+    size_t slotOf(unsigned long long key) const;
+    void resize(size_t slots);
+
+    std::vector<unsigned long long> keys; // NO_INCIDENT for an empty slot
+    std::vector<unsigned> crimes;
+    size_t count;
+    int shift;
+};
+
+#endif
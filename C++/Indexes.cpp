@@ -0,0 +1,103 @@
+/******************************************************************************
+ * Indexes.cpp                                                                *
+ *                                                                            *
+ * The spatial indexes the restauraunts can be kept in, made by name, and a   *
+ * benchmark that pits them all against each other on the crime file.        *
+ ******************************************************************************/
+
+#include "Indexes.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "CrimeIngest.h"
+#include "CsvReader.h"
+#include "DistanceKernel.h"
+#include "HashGrid.hpp"
+#include "KdTree.hpp"
+#include "QuadTree.hpp"
+
+using namespace std;
+
+SpatialIndex<Restauraunt>* makeIndex(const string& name){
+    if(name == "kd")
+        return new KdTree<Restauraunt>;
+    if(name == "grid")
+        return new HashGrid<Restauraunt, CRIME_RADIUS>;
+    if(name == "quad")
+        return new QuadTree<Restauraunt>;
+    return NULL;
+}
+
+// milliseconds since start
+static double millisecondsSince(chrono::steady_clock::time_point start){
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+void benchmarkIndexes(const vector<Restauraunt*>& restauraunts, const char* crimePath,
+                      ostream& out){
+    // Just the metric location of every crime (column 19), so that only the queries
+    // are being timed; a column each of x and y too, for the batches
+    vector<Location> crimes;
+    vector<double> xs, ys;
+    CsvReader crimeFile(crimePath);
+    crimeFile.skipRow();
+    Location l;
+    while(crimeFile.readRow()){
+        if(crimeFile.size() < 20)
+            continue;
+        l.setLocation(crimeFile[19]);
+        crimes.push_back(Location((l.x - MIN_LAT)*LAT_TO_METERS,
+                                  (l.y - MIN_LNG)*LNG_TO_METERS));
+        xs.push_back(crimes.back().x);
+        ys.push_back(crimes.back().y);
+    }
+    out << restauraunts.size() << " restauraunts, " << crimes.size() << " crimes, "
+        << distanceKernelName() << " distance kernel\n";
+
+    const char* names[] = {"kd", "grid", "quad"};
+    for(const char* name : names){
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        SpatialIndex<Restauraunt>* index = makeIndex(name);
+        for(Restauraunt* r : restauraunts)
+            index->insert(r->metricLocation(), r);
+        index->build();
+        double buildTime = millisecondsSince(start);
+
+        // the hits, and the sum of their ids, should be the same for every index
+        long long hits = 0, checksum = 0;
+        vector<Restauraunt*> v;
+        start = chrono::steady_clock::now();
+        for(const Location& crime : crimes){
+            v.clear();
+            index->findNodes(crime, CRIME_RADIUS, v);
+            hits += v.size();
+            for(Restauraunt* r : v)
+                checksum += r->id;
+        }
+        double queryTime = millisecondsSince(start);
+
+        // and again in batches, as the crime pass does them
+        long long batchHits = 0, batchChecksum = 0;
+        QueryBatch<Restauraunt> batch;
+        start = chrono::steady_clock::now();
+        for(size_t first=0;first<crimes.size();first+=JOIN_BATCH_SIZE){
+            size_t n = min((size_t)JOIN_BATCH_SIZE, crimes.size() - first);
+            index->findNodesBatch(&xs[first], &ys[first], n, CRIME_RADIUS, batch);
+            for(size_t i=0;i<n;i++){
+                batchHits += batch.count(i);
+                for(size_t j=0;j<batch.count(i);j++)
+                    batchChecksum += batch.results(i)[j]->id;
+            }
+        }
+        double batchTime = millisecondsSince(start);
+
+        out << name << ": built in " << buildTime << " ms, "
+            << crimes.size() << " queries in " << queryTime << " ms ("
+            << (crimes.empty() ? 0 : queryTime*1e6/crimes.size()) << " ns each), "
+            << hits << " hits (checksum " << checksum << "); batched in "
+            << batchTime << " ms (" << (crimes.empty() ? 0 : batchTime*1e6/crimes.size())
+            << " ns each), " << batchHits << " hits (checksum " << batchChecksum << ")\n";
+        delete index;
+    }
+}
@@ -0,0 +1,29 @@
+/******************************************************************************
+ * Indexes.h                                                                  *
+ *                                                                            *
+ * The spatial indexes the restauraunts can be kept in, made by name, and a   *
+ * benchmark that pits them all against each other on the crime file.        *
+ ******************************************************************************/
+
+#ifndef INDEXES
+#define INDEXES
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Restauraunt.h"
+#include "SpatialIndex.hpp"
+
+// Makes the spatial index named name, or returns NULL if there is no such index:
+//     kd   - the KdTree, balanced and bulk loaded (the default)
+//     grid - a HashGrid with cells CRIME_RADIUS across
+//     quad - the original QuadTree
+SpatialIndex<Restauraunt>* makeIndex(const std::string& name);
+
+// Builds each index out of the restauraunts, then times finding the restauraunts near
+// every crime in the file at crimePath, printing the results to out
+void benchmarkIndexes(const std::vector<Restauraunt*>& restauraunts, const char* crimePath,
+                      std::ostream& out);
+
+#endif
@@ -0,0 +1,186 @@
+/******************************************************************************
+ * InputFile.cpp                                                              *
+ *                                                                            *
+ * The input layer for the (rather large) CSV files. A plain file is memory   *
+ * mapped and handed out as a single block, so the parsers can point straight *
+ * into the page cache without copying a thing. A file ending in .gz is       *
+ * inflated on the fly with zlib, a chunk at a time, so the multi gigabyte    *
+ * crime exports never need to be decompressed to disk first.                 *
+ ******************************************************************************/
+
+#include "InputFile.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+using namespace std;
+
+InputFile::InputFile(){
+    map = NULL;
+    mapLength = fileSize = 0;
+    mapHandedOut = false;
+    gz = NULL;
+    gzDone = false;
+}
+
+InputFile::InputFile(const char* path){
+    map = NULL;
+    mapLength = fileSize = 0;
+    mapHandedOut = false;
+    gz = NULL;
+    gzDone = false;
+    open(path);
+}
+
+InputFile::~InputFile(){
+    close();
+}
+
+// returns true if s ends with suffix
+static bool endsWith(const char* s, const char* suffix){
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && strcmp(s + n - m, suffix) == 0;
+}
+
+bool InputFile::open(const char* path){
+    close();
+    if(endsWith(path, ".gz")){
+        gz = gzopen(path, "rb");
+        if(!gz){
+            cerr << "Could not open " << path << endl;
+            return false;
+        }
+        gzbuffer((gzFile)gz, 1 << 17);
+        gzDone = false;
+        buffer.resize(GZ_BLOCK_SIZE + 1);
+        carry.clear();
+        return true;
+    }
+    return mapFile(path);
+}
+
+// Maps the file so that it is followed by at least one '\0'. The tail of the last
+// page of a mapping is zero filled by the kernel, but if the file happens to end
+// exactly on a page boundary there is no tail, so an anonymous (zeroed) region one
+// byte larger than the file is reserved first and the file is mapped over the front
+// of it.
+bool InputFile::mapFile(const char* path){
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0){
+        ::close(fd);
+        return false;
+    }
+    fileSize = st.st_size;
+    size_t page = sysconf(_SC_PAGESIZE);
+    mapLength = (fileSize + 1 + page - 1) / page * page;
+
+    void* reserved = mmap(NULL, mapLength, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(reserved == MAP_FAILED){
+        ::close(fd);
+        mapLength = fileSize = 0;
+        return false;
+    }
+    if(fileSize > 0 &&
+       mmap(reserved, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED){
+        munmap(reserved, mapLength);
+        ::close(fd);
+        mapLength = fileSize = 0;
+        return false;
+    }
+    ::close(fd);
+    madvise(reserved, mapLength, MADV_SEQUENTIAL);
+    map = (char*)reserved;
+    mapHandedOut = false;
+    return true;
+}
+
+void InputFile::close(){
+    if(map)
+        munmap(map, mapLength);
+    map = NULL;
+    mapLength = fileSize = 0;
+    if(gz)
+        gzclose((gzFile)gz);
+    gz = NULL;
+    gzDone = false;
+}
+
+bool InputFile::isOpen(){
+    return map != NULL || gz != NULL;
+}
+
+bool InputFile::isCompressed(){
+    return gz != NULL;
+}
+
+bool InputFile::nextBlock(const char*& begin, const char*& end){
+    if(map){
+        if(mapHandedOut || fileSize == 0)
+            return false;
+        mapHandedOut = true;
+        begin = map;
+        end   = map + fileSize;
+        return true;
+    }
+    if(gz)
+        return fillGzBlock(begin, end);
+    return false;
+}
+
+// Inflates the next chunk of a .gz file behind whatever partial row was left over
+// from the last one, hands out everything up to the last newline, and sets the
+// rest aside for next time.
+bool InputFile::fillGzBlock(const char*& begin, const char*& end){
+    if(gzDone)
+        return false;
+    size_t filled = carry.size();
+    if(buffer.size() < filled + GZ_BLOCK_SIZE + 1)
+        buffer.resize(filled + GZ_BLOCK_SIZE + 1);
+    if(filled)
+        memcpy(&buffer[0], &carry[0], filled);
+    carry.clear();
+
+    while(true){
+        int n = gzread((gzFile)gz, &buffer[filled], GZ_BLOCK_SIZE);
+        if(n < 0){
+            int err;
+            cerr << "Error inflating input: " << gzerror((gzFile)gz, &err) << endl;
+            n = 0;
+        }
+        if(n == 0){
+            // End of the file: whatever is left is the last row
+            gzDone = true;
+            if(filled == 0)
+                return false;
+            buffer[filled] = '\0';
+            begin = &buffer[0];
+            end   = begin + filled;
+            return true;
+        }
+        filled += n;
+
+        const char* start = &buffer[0];
+        const char* lastNewline = (const char*)memrchr(start, '\n', filled);
+        if(lastNewline){
+            size_t blockSize = lastNewline + 1 - start;
+            carry.assign(start + blockSize, start + filled);
+            buffer[blockSize] = '\0';
+            begin = start;
+            end   = start + blockSize;
+            return true;
+        }
+        // A single row longer than a whole block; keep reading until it ends
+        buffer.resize(filled + GZ_BLOCK_SIZE + 1);
+    }
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ * InputFile.h                                                                *
+ *                                                                            *
+ * The input layer for the (rather large) CSV files. A plain file is memory   *
+ * mapped and handed out as a single block, so the parsers can point straight *
+ * into the page cache without copying a thing. A file ending in .gz is       *
+ * inflated on the fly with zlib, a chunk at a time, so the multi gigabyte    *
+ * crime exports never need to be decompressed to disk first.                 *
+ *                                                                            *
+ * Either way, nextBlock() hands out blocks that always end on a row boundary *
+ * (just after a '\n', or at the end of the file) and are always followed by  *
+ * a '\0', so anything scanning a block can never run off the end of it.      *
+ ******************************************************************************/
+
+#ifndef INPUT_FILE
+#define INPUT_FILE
+
+#include <cstddef>
+#include <vector>
+
+// how much decompressed data is handed out at a time for .gz files
+#define GZ_BLOCK_SIZE (4 << 20)
+
+class InputFile{
+public:
+    InputFile();
+    InputFile(const char* path);
+   ~InputFile();
+
+    // opens path, mapping it or preparing to inflate it; returns false on failure
+    bool open(const char* path);
+    void close();
+
+    bool isOpen();
+    bool isCompressed();
+
+    // sets begin and end to the next block of whole rows, returning false once
+    // the file has been exhausted
+    bool nextBlock(const char*& begin, const char*& end);
+
+private:
+    InputFile(const InputFile&);
+    InputFile& operator=(const InputFile&);
+
+    bool mapFile(const char* path);
+    bool fillGzBlock(const char*& begin, const char*& end);
+
+    // for mapped files
+    char* map;
+    size_t mapLength, fileSize;
+    bool mapHandedOut;
+
+    // for .gz files: a gzFile, kept as a void* to keep zlib.h out of here
+    void* gz;
+    bool gzDone;
+    std::vector<char> buffer;
+    // the partial row left over at the end of the last block
+    std::vector<char> carry;
+};
+
+#endif
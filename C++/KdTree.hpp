@@ -0,0 +1,89 @@
+/******************************************************************************
+ * KdTree.hpp                                                                 *
+ *                                                                            *
+ * A static, bulk loaded k-d tree, as a replacement for the QuadTree. The     *
+ * QuadTree gets built one restauraunt at a time in whatever order they come  *
+ * in the CSV (by name, not location), so it ends up lopsided, and every node *
+ * is its own allocation somewhere on the heap. This instead waits until it   *
+ * has every object, then sorts them into a balanced tree in one go.          *
+ *                                                                            *
+ * The tree is implicit: every node splits its objects exactly in half (at    *
+ * the median along whichever axis they are most spread out on), so the shape *
+ * of the tree depends only on how many objects there are. Node i's children  *
+ * are nodes 2i+1 and 2i+2, and all a node needs to store is where it splits. *
+ * The objects themselves sit in leaf order in plain arrays of x, y and data, *
+ * KD_LEAF_SIZE or fewer to a leaf. The depth is at most log2(n), so queries  *
+ * walk the tree with a small fixed size stack rather than recursing.         *
+ *                                                                            *
+ * A whole QueryBatch is answered in a single walk: each step down the tree   *
+ * carries along the subset of the batch's queries that reach that far, so a  *
+ * node is visited once per batch rather than once per query.                 *
+ *                                                                            *
+ * Since the tree is only ever a handful of arrays, kdForEachNear can walk    *
+ * one that isn't in a KdTree at all, like the copy in a MappedSnapshot.      *
+ ******************************************************************************/
+
+#ifndef KD_TREE
+#define KD_TREE
+
+#include <vector>
+
+#include "Location.h"
+#include "SpatialIndex.hpp"
+
+// the most objects a leaf can hold
+#define KD_LEAF_SIZE 8
+
+// Calls visit(i) for every object i (counting in leaf order) of the n in a tree laid out
+// as a KdTree lays them out that is strictly within radius of l
+template<class F>
+void kdForEachNear(const double* xs, const double* ys, size_t n, const double* splits,
+                   const unsigned char* axes, const Location& l, int radius, F visit);
+
+template<class T>
+class KdTree : public SpatialIndex<T>{
+public:
+    KdTree();
+
+    // objects are only collected here, until build is called
+    void insert(Location l, T* data);
+    // builds the tree out of everything inserted so far
+    void build();
+
+    // appends every object strictly within radius of l to v
+    void findNodes(const Location& l, int radius, std::vector<T*>& v);
+    std::vector<T*> findNodes(Location l, int radius);
+    // answers every query in the batch with one walk of the tree
+    void findNodesBatch(const double* qxs, const double* qys, size_t n, int radius,
+                        QueryBatch<T>& batch);
+
+    size_t size();
+    // how many levels of nodes there are above the leaves
+    int depth();
+
+    // the arrays the tree is kept in (see below), for copying it somewhere else
+    const std::vector<double>& leafXs() const { return xs; }
+    const std::vector<double>& leafYs() const { return ys; }
+    const std::vector<T*>& leafItems() const { return items; }
+    const std::vector<double>& splitValues() const { return splits; }
+    const std::vector<unsigned char>& splitAxes() const { return axes; }
+
+private:
+    // sorts the objects order[lo, hi) into the subtree rooted at node
+    void buildNode(std::vector<size_t>& order, size_t node, size_t lo, size_t hi, int level);
+
+    // the objects, in leaf order once built
+    std::vector<double> xs, ys;
+    std::vector<T*> items;
+
+    // for each inner node, the coordinate it splits at and whether that is a y (1)
+    // or an x (0) coordinate
+    std::vector<double> splits;
+    std::vector<unsigned char> axes;
+
+    int levels;
+};
+
+#include "KdTree.tpp"
+
+#endif
@@ -0,0 +1,208 @@
+/******************************************************************************
+ * KdTree.tpp                                                                 *
+ *                                                                            *
+ * A static, bulk loaded k-d tree, as a replacement for the QuadTree: every   *
+ * object is sorted into a balanced tree in one go, stored in a handful of    *
+ * flat arrays, and searched without recursion.                               *
+ ******************************************************************************/
+
+#include <algorithm>
+
+#include "DistanceKernel.h"
+
+template<class T>
+KdTree<T>::KdTree(){
+    levels = 0;
+}
+
+template<class T>
+void KdTree<T>::insert(Location l, T* data){
+    xs.push_back(l.x);
+    ys.push_back(l.y);
+    items.push_back(data);
+}
+
+template<class T>
+size_t KdTree<T>::size(){
+    return items.size();
+}
+
+template<class T>
+int KdTree<T>::depth(){
+    return levels;
+}
+
+// Sorts every object into place. The objects are shuffled through an array of indices,
+// and only copied into their final order once every node knows where it splits
+template<class T>
+void KdTree<T>::build(){
+    size_t n = items.size();
+    splits.clear();
+    axes.clear();
+    levels = 0;
+
+    std::vector<size_t> order(n);
+    for(size_t i=0;i<n;i++)
+        order[i] = i;
+    buildNode(order, 0, 0, n, 0);
+
+    std::vector<double> oldXs(xs), oldYs(ys);
+    std::vector<T*> oldItems(items);
+    for(size_t i=0;i<n;i++){
+        xs[i] = oldXs[order[i]];
+        ys[i] = oldYs[order[i]];
+        items[i] = oldItems[order[i]];
+    }
+}
+
+template<class T>
+void KdTree<T>::buildNode(std::vector<size_t>& order, size_t node, size_t lo, size_t hi,
+                          int level){
+    if(hi - lo <= KD_LEAF_SIZE){
+        if(level > levels)
+            levels = level;
+        return;
+    }
+    // split along whichever axis the objects are most spread out on
+    double minX = xs[order[lo]], maxX = minX, minY = ys[order[lo]], maxY = minY;
+    for(size_t i=lo+1;i<hi;i++){
+        double x = xs[order[i]], y = ys[order[i]];
+        minX = std::min(minX, x); maxX = std::max(maxX, x);
+        minY = std::min(minY, y); maxY = std::max(maxY, y);
+    }
+    unsigned char axis = (maxY - minY) > (maxX - minX);
+    const std::vector<double>& coords = axis ? ys : xs;
+    size_t mid = lo + (hi - lo)/2;
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi,
+                     [&](size_t a, size_t b){ return coords[a] < coords[b]; });
+    if(node >= splits.size()){
+        splits.resize(node + 1, 0);
+        axes.resize(node + 1, 0);
+    }
+    splits[node] = coords[order[mid]];
+    axes[node] = axis;
+    buildNode(order, 2*node + 1, lo, mid, level + 1);
+    buildNode(order, 2*node + 2, mid, hi, level + 1);
+}
+
+template<class T>
+std::vector<T*> KdTree<T>::findNodes(Location l, int radius){
+    std::vector<T*> v;
+    findNodes(l, radius, v);
+    return v;
+}
+
+template<class T>
+void KdTree<T>::findNodes(const Location& l, int radius, std::vector<T*>& v){
+    kdForEachNear(xs.data(), ys.data(), items.size(), splits.data(), axes.data(), l, radius,
+                  [&](size_t i){ v.push_back(items[i]); });
+}
+
+// Walks the tree with an explicit stack of (node, first object, one past last object).
+// Everything left of a split is <= it and everything right is >= it, so a side is
+// only worth visiting if the circle around l reaches it.
+template<class F>
+void kdForEachNear(const double* xs, const double* ys, size_t n, const double* splits,
+                   const unsigned char* axes, const Location& l, int radius, F visit){
+    struct Frame{
+        size_t node, lo, hi;
+    };
+    // two frames per level is more than enough, and the depth is at most log2(n)
+    Frame stack[2*64];
+    int top = 0;
+    double r = radius;
+    double r2 = (double)radius*radius;
+    if(n == 0)
+        return;
+    Frame root = {0, 0, n};
+    stack[top++] = root;
+    while(top > 0){
+        Frame f = stack[--top];
+        if(f.hi - f.lo <= KD_LEAF_SIZE){
+            unsigned long long found = distanceMask(&xs[f.lo], &ys[f.lo], f.hi - f.lo, l, r2);
+            while(found){
+                visit(f.lo + __builtin_ctzll(found));
+                found &= found - 1;
+            }
+            continue;
+        }
+        size_t mid = f.lo + (f.hi - f.lo)/2;
+        double q = axes[f.node] ? l.y : l.x;
+        double split = splits[f.node];
+        if(q + r >= split){
+            Frame right = {2*f.node + 2, mid, f.hi};
+            stack[top++] = right;
+        }
+        if(q - r <= split){
+            Frame left = {2*f.node + 1, f.lo, mid};
+            stack[top++] = left;
+        }
+    }
+}
+
+// The same walk as findNodes, but each frame also holds the range of batch.subset with
+// the queries that reach its node. A node hands on to each side the queries whose
+// circles reach that side, appended to the end of the subset. Frames are popped in the
+// reverse of the order their ranges were appended in, so everything after the popped
+// frame's range belongs to nodes that are finished with, and can be dropped.
+template<class T>
+void KdTree<T>::findNodesBatch(const double* qxs, const double* qys, size_t n, int radius,
+                               QueryBatch<T>& batch){
+    struct Frame{
+        size_t node, lo, hi;
+        size_t first, last; // the node's queries are subset[first, last)
+    };
+    batch.reset(qxs, qys, n);
+    if(items.empty() || n == 0){
+        batch.finish();
+        return;
+    }
+    Frame stack[2*64];
+    int top = 0;
+    double r = radius;
+    double r2 = (double)radius*radius;
+    std::vector<unsigned>& subset = batch.subset;
+    subset.assign(batch.order.begin(), batch.order.end());
+    Frame root = {0, 0, items.size(), 0, n};
+    stack[top++] = root;
+    while(top > 0){
+        Frame f = stack[--top];
+        subset.resize(f.last);
+        if(f.hi - f.lo <= KD_LEAF_SIZE){
+            for(size_t j=f.first;j<f.last;j++){
+                unsigned q = subset[j];
+                unsigned long long found = distanceMask(&xs[f.lo], &ys[f.lo], f.hi - f.lo,
+                                                        Location(qxs[q], qys[q]), r2);
+                while(found){
+                    batch.add(q, items[f.lo + __builtin_ctzll(found)]);
+                    found &= found - 1;
+                }
+            }
+            continue;
+        }
+        size_t mid = f.lo + (f.hi - f.lo)/2;
+        bool useY = axes[f.node];
+        double split = splits[f.node];
+        size_t rightFirst = subset.size();
+        for(size_t j=f.first;j<f.last;j++){
+            unsigned q = subset[j];
+            if((useY ? qys[q] : qxs[q]) + r >= split)
+                subset.push_back(q);
+        }
+        size_t leftFirst = subset.size();
+        for(size_t j=f.first;j<f.last;j++){
+            unsigned q = subset[j];
+            if((useY ? qys[q] : qxs[q]) - r <= split)
+                subset.push_back(q);
+        }
+        if(leftFirst > rightFirst){
+            Frame right = {2*f.node + 2, mid, f.hi, rightFirst, leftFirst};
+            stack[top++] = right;
+        }
+        if(subset.size() > leftFirst){
+            Frame left = {2*f.node + 1, f.lo, mid, leftFirst, subset.size()};
+            stack[top++] = left;
+        }
+    }
+    batch.finish();
+}
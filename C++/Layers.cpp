@@ -0,0 +1,138 @@
+/******************************************************************************
+ * Layers.cpp                                                                 *
+ *                                                                            *
+ * The other kinds of places scored along with the restauraunts.              *
+ ******************************************************************************/
+
+#include "Layers.h"
+
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "CsvReader.h"
+#include "Parse.h"
+#include "Restauraunt.h"
+
+using namespace std;
+
+Location Place::latLng() const{
+    return Location((double)lat/FIXED_PER_DEGREE, (double)lng/FIXED_PER_DEGREE);
+}
+
+Location Place::metricLocation() const{
+    Location l = latLng();
+    return Location((l.x - MIN_LAT)*LAT_TO_METERS, (l.y - MIN_LNG)*LNG_TO_METERS);
+}
+
+Layers::Layers(){
+}
+
+// A layer's name ends up in the name of the file it is written to, so it can only be
+// letters, digits, '_' and '-': nothing that could take it out of the data directory
+static bool validName(const string& name){
+    for(char c : name)
+        if(!isalnum((unsigned char)c) && c != '_' && c != '-')
+            return false;
+    return !name.empty();
+}
+
+bool Layers::load(const char* path){
+    ifstream in(path);
+    if(!in)
+        return false;
+    string line;
+    int lineNumber = 0;
+    while(getline(in, line)){
+        lineNumber++;
+        size_t hash = line.find('#');
+        if(hash != string::npos)
+            line.erase(hash);
+        istringstream words(line);
+        Layer layer;
+        if(!(words >> layer.name))
+            continue;
+        layer.lngColumn = -1;
+        if(!(words >> layer.path >> layer.nameColumn >> layer.latColumn) ||
+           layer.nameColumn < 0 || layer.latColumn < 0){
+            cerr << path << ":" << lineNumber << ": didn't understand \"" << line << "\"\n";
+            continue;
+        }
+        if(!validName(layer.name)){
+            cerr << path << ":" << lineNumber << ": \"" << layer.name
+                 << "\" isn't a layer name (only letters, digits, _ and - are)\n";
+            continue;
+        }
+        words >> layer.lngColumn;
+        layer.first = layer.last = 0;
+        layers.push_back(layer);
+    }
+    return true;
+}
+
+bool Layers::read(ostream& log){
+    bool ok = true;
+    for(size_t i=0;i<layers.size();i++){
+        Layer& layer = layers[i];
+        layer.first = places.size();
+        CsvReader file(layer.path.c_str());
+        if(!file.isOpen()){
+            log << "Could not read the " << layer.name << " layer from " << layer.path << endl;
+            ok = false;
+            layer.last = places.size();
+            continue;
+        }
+        file.skipRow(); // the header
+        int columns = max(layer.nameColumn, max(layer.latColumn, layer.lngColumn)) + 1;
+        size_t skipped = 0;
+        while(file.readRow()){
+            if((int)file.size() < columns){
+                skipped++;
+                continue;
+            }
+            Location l;
+            if(layer.lngColumn < 0){
+                l.setLocation(file[layer.latColumn]);
+            }else if(!parseDouble(file[layer.latColumn], l.x) ||
+                     !parseDouble(file[layer.lngColumn], l.y)){
+                l.x = l.y = 0;
+            }
+            if(l.x == 0){
+                skipped++;
+                continue;
+            }
+            Place* p = arena.make();
+            p->lat = (int)lround(l.x*FIXED_PER_DEGREE);
+            p->lng = (int)lround(l.y*FIXED_PER_DEGREE);
+            p->name = names.intern(file[layer.nameColumn]);
+            p->layer = (unsigned)i;
+            p->id = (int)places.size();
+            p->crimeCost = 0;
+            index.insert(p->metricLocation(), p);
+            places.push_back(p);
+        }
+        layer.last = places.size();
+        log << layer.last - layer.first << " places in the " << layer.name << " layer";
+        if(skipped)
+            log << " (and " << skipped << " rows without a location)";
+        log << '\n';
+    }
+    index.build();
+    return ok;
+}
+
+void Layers::write(const string& prefix) const{
+    for(const Layer& layer : layers){
+        ofstream out((prefix + layer.name + ".csv").c_str());
+        out << "Location, Name, CrimeCost, Crimes\n";
+        for(size_t i=layer.first;i<layer.last;i++){
+            const Place* p = places[i];
+            Location l = p->latLng();
+            out << '"' << l << "\", ";
+            Restauraunt::writeQuoted(out, names.str(p->name));
+            out << ", " << p->crimeCost << ", " << links.count(p->id) << '\n';
+        }
+    }
+}
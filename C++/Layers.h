@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Layers.h                                                                   *
+ *                                                                            *
+ * Restauraunts aren't the only places worth knowing the crimes around: bars, *
+ * schools, transit stops and ATMs can all be scored the same way. Each of    *
+ * these is a layer, read from a CSV of its own, with the columns holding     *
+ * each place's name and location given in a layer file, one layer a line:    *
+ *                                                                            *
+ *     NAME FILE NAME_COLUMN LOCATION_COLUMN [LNG_COLUMN]                     *
+ *                                                                            *
+ * (columns counted from 0). With one location column it is a "(lat, lng)"    *
+ * like the licence file's; with two, the latitude and then the longitude.    *
+ * The NAME goes in the name of the layer's CSV, so it can only have letters, *
+ * digits, '_' and '-' in it; lines with any other name are reported and      *
+ * skipped.                                                                   *
+ *                                                                            *
+ * The places of every layer go in the one KdTree, so the crime pass probes   *
+ * it once per crime however many layers there are (see CrimeIngest::join),   *
+ * alongside the restauraunts, and links the crimes to the places just as it  *
+ * links them to the restauraunts. Places have no licence date, so every      *
+ * crime counts as having happened since the place opened. Each layer is      *
+ * written to a CSV of its own.                                               *
+ ******************************************************************************/
+
+#ifndef LAYERS
+#define LAYERS
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Arena.hpp"
+#include "CrimeLinks.h"
+#include "KdTree.hpp"
+#include "Location.h"
+#include "StringPool.h"
+
+// a place in one of the layers
+struct Place{
+    // the location, in fixed point, as a restauraunt's is
+    int lat, lng;
+    // number of the name in Layers::names
+    unsigned name;
+    unsigned layer;
+    // the place's index in Layers::places, which is what its CrimeHits hold in place of
+    // a restauraunt's id
+    int id;
+    int crimeCost;
+
+    Location latLng() const;
+    Location metricLocation() const;
+};
+
+class Layers{
+public:
+    Layers();
+
+    // reads the layer file at path (see above), returning false if there isn't one.
+    // Lines that don't make sense (or name a layer badly) are reported and skipped
+    bool load(const char* path);
+    // reads every layer's places into the index, returning false if a layer's file
+    // couldn't be opened. Rows without a location are skipped
+    bool read(std::ostream& log);
+
+    // how many layers there are, and what the layer is called
+    size_t size() const { return layers.size(); }
+    const std::string& name(size_t layer) const { return layers[layer].name; }
+
+    // writes each layer to prefix + its name + ".csv", a row per place with its
+    // location, name, crime cost and number of crimes
+    void write(const std::string& prefix) const;
+
+    // every place of every layer, a layer at a time
+    std::vector<Place*> places;
+    KdTree<Place> index;
+    // the crimes near each place (filled in by the crime pass)
+    CrimeLinks links;
+    StringPool names;
+
+private:
+    Layers(const Layers&);
+    Layers& operator=(const Layers&);
+
+    struct Layer{
+        std::string name, path;
+        int nameColumn, latColumn, lngColumn;
+        // its places are places[first] up to places[last]
+        size_t first, last;
+    };
+    std::vector<Layer> layers;
+    Arena<Place> arena;
+};
+
+#endif
@@ -8,6 +8,7 @@
  ******************************************************************************/
 
 #include "Location.h"
+#include "Parse.h"
 
 // Constructors:
 Location::Location(){
@@ -40,6 +41,23 @@ void Location::setLocation(char* s){
     sscanf(s, "\"(%lf, %lf)\"", &x, &y);
 }  
 
+// parses location from a field in the form of (###, ###)
+void Location::setLocation(const Field& f){
+    const char* p = f.begin;
+    x = y = 0;
+    if(p < f.end && *p == '(')
+        p++;
+    if(!parseDouble(p, f.end, x) || p >= f.end || *p != ','){
+        x = 0;
+        return;
+    }
+    p++;
+    while(p < f.end && *p == ' ')
+        p++;
+    if(!parseDouble(p, f.end, y))
+        x = y = 0;
+}
+
 // returns the (delta X)^2 + (delta Y)^2
 // as the distances are merely compared, the square root necessary
 // to make this an actual distance function is unnecessaryy
@@ -13,6 +13,8 @@
 #include <cstdio>
 #include <ostream>
 
+#include "Field.h"
+
 class Location{
 public:
     double x, y;
@@ -30,6 +32,9 @@ public:
     void setLocation(double x, double y);
     // or to a parsing of a string in the form of "###, ###" 
     void setLocation(char* s);
+    // or to a parsing of a field in the form of (###, ###), with the quotes already
+    // stripped by the CsvReader
+    void setLocation(const Field& f);
     
     
     // returns the (delta X)^2 + (delta Y)^2
@@ -0,0 +1,345 @@
+/******************************************************************************
+ * MappedSnapshot.cpp                                                         *
+ *                                                                            *
+ * A Snapshot saved so that it can be mapped and queried as it is.            *
+ ******************************************************************************/
+
+#include "MappedSnapshot.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "KdTree.hpp"
+#include "Restauraunt.h"
+
+using namespace std;
+
+// the first 8 bytes of every snapshot file
+static const char MAGIC[8] = {'C', 'R', 'I', 'M', 'E', 'M', 'A', 'P'};
+
+// The sections, by number
+enum{
+    SECTION_RESTAURAUNTS, SECTION_STRING_STARTS, SECTION_CHARS,
+    SECTION_KD_XS, SECTION_KD_YS, SECTION_KD_ITEMS, SECTION_KD_SPLITS, SECTION_KD_AXES,
+    SECTION_CRIME_LATS, SECTION_CRIME_LNGS, SECTION_CRIME_DAYS, SECTION_CRIME_TYPES,
+    SECTION_CRIME_WEAPONS, SECTION_LINK_STARTS, SECTION_LINK_IDS,
+    SECTIONS
+};
+
+struct MappedHeader{
+    char magic[8];
+    unsigned version;
+    unsigned sections;
+    // the length of the whole file, and the checksum of everything after the header
+    unsigned long long bytes;
+    unsigned long long checksum;
+};
+
+// where a section is in the file, and how many elements of how many bytes it has
+struct MappedSection{
+    unsigned id;
+    unsigned width;
+    unsigned long long offset;
+    unsigned long long count;
+};
+
+// FNV-1a, 8 bytes at a time rather than 1 (everything is padded out to 8 bytes), which
+// checks a file of a few tens of megabytes in a few milliseconds
+static unsigned long long checksum(const char* begin, const char* end){
+    unsigned long long h = 14695981039346656037ULL;
+    for(const char* p=begin;p<end;p+=8){
+        unsigned long long word;
+        memcpy(&word, p, 8);
+        h ^= word;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+MappedSnapshot::MappedSnapshot(){
+    generation = 1;
+    map = NULL;
+    mapLength = 0;
+    restauraunts = NULL;
+    stringStarts = NULL;
+    chars = NULL;
+    kdXs = kdYs = kdSplits = NULL;
+    kdItems = NULL;
+    kdAxes = NULL;
+    crimeLats = crimeLngs = NULL;
+    crimeDays = NULL;
+    crimeTypes = crimeWeapons = NULL;
+    linkStarts = NULL;
+    linkIds = NULL;
+    restaurauntCount = stringCount = crimeCount = linkCount = 0;
+}
+
+MappedSnapshot::~MappedSnapshot(){
+    if(map)
+        munmap((void*)map, mapLength);
+}
+
+// Everything is laid out in one buffer first, so the checksum can be worked out before
+// the header is written
+bool MappedSnapshot::write(const char* path, const Snapshot& snapshot){
+    const vector<Restauraunt*>& rs = snapshot.restauraunts;
+    const CrimeTable& table = snapshot.crimes->table;
+    const CrimeLinks& links = snapshot.crimes->links;
+
+    vector<MappedRestauraunt> restauraunts(rs.size());
+    for(size_t i=0;i<rs.size();i++){
+        MappedRestauraunt& m = restauraunts[i];
+        m.lat = rs[i]->lat;
+        m.lng = rs[i]->lng;
+        m.name = rs[i]->name;
+        m.address = rs[i]->address;
+        m.description = rs[i]->description;
+        m.day = rs[i]->date.epochDay();
+        m.crimeCost = rs[i]->crimeCost;
+        m.unused = 0;
+    }
+    const StringPool& strings = Restauraunt::strings;
+    vector<unsigned long long> stringStarts(strings.size() + 1, 0);
+    vector<char> chars;
+    for(size_t id=0;id<strings.size();id++){
+        chars.insert(chars.end(), strings.str(id), strings.str(id) + strings.length(id) + 1);
+        stringStarts[id + 1] = chars.size();
+    }
+    // The index is always a KdTree, whichever the snapshot used, as it is only a few
+    // arrays
+    KdTree<Restauraunt> tree;
+    for(Restauraunt* r : rs)
+        tree.insert(r->metricLocation(), r);
+    tree.build();
+    vector<unsigned> kdItems;
+    for(Restauraunt* r : tree.leafItems())
+        kdItems.push_back(r->id);
+    // (uncompressed, if they were compressed)
+    vector<unsigned long long> linkStarts(1, 0);
+    vector<unsigned> linkIds;
+    for(size_t r=0;r<rs.size();r++){
+        links.forEach(r, [&](unsigned crime){ linkIds.push_back(crime); });
+        linkStarts.push_back(linkIds.size());
+    }
+
+    struct Piece{
+        const void* data;
+        size_t width, count;
+    };
+    Piece pieces[SECTIONS] = {
+        {restauraunts.data(), sizeof(MappedRestauraunt), restauraunts.size()},
+        {stringStarts.data(), sizeof(unsigned long long), stringStarts.size()},
+        {chars.data(), 1, chars.size()},
+        {tree.leafXs().data(), sizeof(double), tree.leafXs().size()},
+        {tree.leafYs().data(), sizeof(double), tree.leafYs().size()},
+        {kdItems.data(), sizeof(unsigned), kdItems.size()},
+        {tree.splitValues().data(), sizeof(double), tree.splitValues().size()},
+        {tree.splitAxes().data(), 1, tree.splitAxes().size()},
+        {table.lats.data(), sizeof(double), table.lats.size()},
+        {table.lngs.data(), sizeof(double), table.lngs.size()},
+        {table.days.data(), sizeof(int), table.days.size()},
+        {table.types.data(), 1, table.types.size()},
+        {table.weapons.data(), 1, table.weapons.size()},
+        {linkStarts.data(), sizeof(unsigned long long), linkStarts.size()},
+        {linkIds.data(), sizeof(unsigned), linkIds.size()},
+    };
+    size_t offset = sizeof(MappedHeader) + SECTIONS*sizeof(MappedSection);
+    vector<MappedSection> sections(SECTIONS);
+    for(int i=0;i<SECTIONS;i++){
+        sections[i].id = i;
+        sections[i].width = (unsigned)pieces[i].width;
+        sections[i].offset = offset;
+        sections[i].count = pieces[i].count;
+        offset += (pieces[i].width*pieces[i].count + 7)/8*8;
+    }
+    vector<char> body(offset - sizeof(MappedHeader), 0);
+    memcpy(&body[0], sections.data(), SECTIONS*sizeof(MappedSection));
+    for(int i=0;i<SECTIONS;i++)
+        if(pieces[i].count)
+            memcpy(&body[sections[i].offset - sizeof(MappedHeader)], pieces[i].data,
+                   pieces[i].width*pieces[i].count);
+
+    MappedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = MAPPED_SNAPSHOT_VERSION;
+    header.sections = SECTIONS;
+    header.bytes = offset;
+    header.checksum = checksum(body.data(), body.data() + body.size());
+
+    string temporary = string(path) + ".new";
+    {
+        ofstream out(temporary.c_str(), ios::binary);
+        out.write((const char*)&header, sizeof(header));
+        out.write(body.data(), body.size());
+        if(!out)
+            return false;
+    }
+    return rename(temporary.c_str(), path) == 0;
+}
+
+const void* MappedSnapshot::section(unsigned id, size_t width, size_t& count) const{
+    const MappedHeader* header = (const MappedHeader*)map;
+    const MappedSection* table = (const MappedSection*)(map + sizeof(MappedHeader));
+    for(unsigned i=0;i<header->sections;i++){
+        const MappedSection& s = table[i];
+        if(s.id != id)
+            continue;
+        if(s.width != width || s.offset % 8 != 0 || s.offset > mapLength ||
+           s.count > (mapLength - s.offset)/width || (count && s.count != count))
+            return NULL;
+        count = s.count;
+        return map + s.offset;
+    }
+    return NULL;
+}
+
+// how many splits a KdTree of n objects has, given the node it starts at
+static size_t splitsNeeded(size_t node, size_t n){
+    if(n <= KD_LEAF_SIZE)
+        return 0;
+    size_t half = n/2;
+    return max(node + 1, max(splitsNeeded(2*node + 1, half), splitsNeeded(2*node + 2, n - half)));
+}
+
+bool MappedSnapshot::open(const char* path){
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0){
+        cerr << "Could not open " << path << endl;
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MappedHeader)){
+        cerr << path << " isn't a snapshot\n";
+        ::close(fd);
+        return false;
+    }
+    mapLength = st.st_size;
+    void* mapped = mmap(NULL, mapLength, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mapped == MAP_FAILED){
+        cerr << "Could not map " << path << endl;
+        mapLength = 0;
+        return false;
+    }
+    map = (const char*)mapped;
+
+    const MappedHeader* header = (const MappedHeader*)map;
+    if(memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+       header->version != MAPPED_SNAPSHOT_VERSION){
+        cerr << path << " isn't a snapshot of version " << MAPPED_SNAPSHOT_VERSION << endl;
+        return false;
+    }
+    if(header->bytes != mapLength || mapLength % 8 != 0 ||
+       header->sections*sizeof(MappedSection) > mapLength - sizeof(MappedHeader) ||
+       checksum(map + sizeof(MappedHeader), map + mapLength) != header->checksum){
+        cerr << path << " has been cut short or damaged\n";
+        return false;
+    }
+
+    // Every section has to be there, and all of the right sizes (a count of 0 going into
+    // section() taking whatever the section has)
+    restaurauntCount = stringCount = crimeCount = linkCount = 0;
+    size_t n = 0, kd = 0, splits = 0, crimes = 0, starts = 0, bytes = 0;
+    restauraunts = (const MappedRestauraunt*)section(SECTION_RESTAURAUNTS,
+                                                      sizeof(MappedRestauraunt), n);
+    restaurauntCount = n;
+    stringStarts = (const unsigned long long*)section(SECTION_STRING_STARTS,
+                                                      sizeof(unsigned long long), starts);
+    chars = (const char*)section(SECTION_CHARS, 1, bytes);
+    kd = n;
+    kdXs = (const double*)section(SECTION_KD_XS, sizeof(double), kd);
+    kdYs = (const double*)section(SECTION_KD_YS, sizeof(double), kd);
+    kdItems = (const unsigned*)section(SECTION_KD_ITEMS, sizeof(unsigned), kd);
+    kdSplits = (const double*)section(SECTION_KD_SPLITS, sizeof(double), splits);
+    kdAxes = (const unsigned char*)section(SECTION_KD_AXES, 1, splits);
+    crimeLats = (const double*)section(SECTION_CRIME_LATS, sizeof(double), crimes);
+    crimeLngs = (const double*)section(SECTION_CRIME_LNGS, sizeof(double), crimes);
+    crimeDays = (const int*)section(SECTION_CRIME_DAYS, sizeof(int), crimes);
+    crimeTypes = (const unsigned char*)section(SECTION_CRIME_TYPES, 1, crimes);
+    crimeWeapons = (const unsigned char*)section(SECTION_CRIME_WEAPONS, 1, crimes);
+    crimeCount = crimes;
+    size_t linkStartCount = n + 1;
+    linkStarts = (const unsigned long long*)section(SECTION_LINK_STARTS,
+                                                    sizeof(unsigned long long), linkStartCount);
+    linkIds = (const unsigned*)section(SECTION_LINK_IDS, sizeof(unsigned), linkCount);
+    bool ok = restauraunts && stringStarts && starts > 0 && chars && kdXs && kdYs && kdItems &&
+              (kdSplits || splitsNeeded(0, n) == 0) && crimeLats && crimeLngs && crimeDays &&
+              crimeTypes && crimeWeapons && linkStarts && linkIds;
+    // and everything that is a number of something else has to be one
+    ok = ok && splits >= splitsNeeded(0, n) && stringStarts[starts - 1] <= bytes &&
+         linkStarts[0] == 0 && linkStarts[n] == linkCount;
+    stringCount = starts - 1;
+    for(size_t i=0;ok && i<n;i++)
+        ok = kdItems[i] < n && linkStarts[i] <= linkStarts[i + 1] &&
+             restauraunts[i].name < stringCount && restauraunts[i].address < stringCount &&
+             restauraunts[i].description < stringCount;
+    for(size_t i=0;ok && i<stringCount;i++)
+        ok = stringStarts[i] < stringStarts[i + 1];
+    for(size_t i=0;ok && i<linkCount;i++)
+        ok = linkIds[i] < crimeCount;
+    if(!ok){
+        cerr << path << " doesn't hang together\n";
+        return false;
+    }
+    return true;
+}
+
+// (ties go by the order they were read in, just as Snapshot::near's do)
+static bool nearer(const pair<double, unsigned>& a, const pair<double, unsigned>& b){
+    return a.first < b.first || (a.first == b.first && a.second < b.second);
+}
+
+void MappedSnapshot::near(const Location& latLng, int radius, vector<unsigned>& found) const{
+    Location l((latLng.x - MIN_LAT)*LAT_TO_METERS, (latLng.y - MIN_LNG)*LNG_TO_METERS);
+    vector<pair<double, unsigned> > byDistance;
+    kdForEachNear(kdXs, kdYs, restaurauntCount, kdSplits, kdAxes, l, radius, [&](size_t i){
+        byDistance.push_back(make_pair(hypot(kdXs[i] - l.x, kdYs[i] - l.y), kdItems[i]));
+    });
+    sort(byDistance.begin(), byDistance.end(), nearer);
+    found.clear();
+    for(const pair<double, unsigned>& p : byDistance)
+        found.push_back(p.second);
+}
+
+void MappedSnapshot::find(const string& text, vector<unsigned>& found) const{
+    found.clear();
+    auto sameLetter = [](char a, char b){ return tolower((unsigned char)a) == tolower((unsigned char)b); };
+    for(size_t r=0;r<restaurauntCount;r++){
+        const char* name = str(restauraunts[r].name);
+        const char* end = name + length(restauraunts[r].name);
+        if(search(name, end, text.begin(), text.end(), sameLetter) != end)
+            found.push_back((unsigned)r);
+    }
+}
+
+// Exactly as Snapshot::describe does it, so the answers are the same either way
+void MappedSnapshot::describe(ostream& out, unsigned r) const{
+    const MappedRestauraunt& m = restauraunts[r];
+    Location l((double)m.lat/FIXED_PER_DEGREE, (double)m.lng/FIXED_PER_DEGREE);
+    Restauraunt::writeQuoted(out, str(m.name));
+    out << ", ";
+    Restauraunt::writeQuoted(out, str(m.address));
+    size_t first = linkStarts[r], last = linkStarts[r + 1];
+    out << ", \"" << l << "\", " << m.crimeCost << ", " << last - first << ", ";
+    if(first == last)
+        out << "never";
+    else
+        out << Date::fromEpochDay(crimeDays[linkIds[last - 1]]);
+    out << '\n';
+}
+
+void MappedSnapshot::stats(ostream& out) const{
+    out << restaurauntCount << " restauraunts, " << crimeCount << " crimes, "
+        << linkCount << " links";
+}
@@ -0,0 +1,115 @@
+/******************************************************************************
+ * MappedSnapshot.h                                                           *
+ *                                                                            *
+ * A Snapshot saved in a form that can be memory mapped and queried as it is, *
+ * with nothing parsed, rebuilt or even copied: write() saves one, and open() *
+ * maps it and checks it over, after which it answers the same queries as the *
+ * Snapshot it came from (./analyze -q -m FILE). Any number of processes can  *
+ * map the same file, and share its pages through the page cache.            *
+ *                                                                            *
+ * The file is a header (a magic number, the version, how long the file is   *
+ * and a checksum of everything after the header), then a table of sections,  *
+ * then the sections themselves, each an array of plain numbers:              *
+ *                                                                            *
+ *  - the restauraunts, as MappedRestauraunts                                 *
+ *  - the strings of Restauraunt::strings, as where each starts and then all  *
+ *    of their characters ('\0' terminated)                                   *
+ *  - the restauraunts in a KdTree, as its arrays (see KdTree.hpp), with each *
+ *    leaf object being the number of a restauraunt                           *
+ *  - the crimes' latitudes, longitudes, days, types and weapons              *
+ *  - the links, as where each restauraunt's start and then the crimes        *
+ *                                                                            *
+ * Everything refers to everything else by number or by offset from the      *
+ * start of the file, never by pointer, so the file means the same wherever   *
+ * it is mapped. It is written in the byte order of the machine writing it,   *
+ * like State.bin is, and every section starts on an 8 byte boundary.         *
+ *                                                                            *
+ * The file is written to a temporary file next to it and renamed over it, so *
+ * a process that already has the old one mapped carries on with it happily.  *
+ ******************************************************************************/
+
+#ifndef MAPPED_SNAPSHOT
+#define MAPPED_SNAPSHOT
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Location.h"
+#include "Snapshot.h"
+
+#define MAPPED_SNAPSHOT_VERSION 2
+
+// a restauraunt as it is stored in the file
+struct MappedRestauraunt{
+    // in fixed point, as a Restauraunt's are
+    int lat, lng;
+    // numbers of the strings in the file
+    unsigned name, address, description;
+    // the licence date, as a day since 1/1/1970
+    int day;
+    int crimeCost;
+    unsigned unused;
+};
+
+class MappedSnapshot{
+public:
+    MappedSnapshot();
+   ~MappedSnapshot();
+
+    // saves snapshot to path, returning false if it couldn't be
+    static bool write(const char* path, const Snapshot& snapshot);
+
+    // maps the file at path, returning false (and saying why on cerr) if it couldn't
+    // be, or isn't a snapshot of this version, or has been damaged
+    bool open(const char* path);
+
+    // the same queries as a Snapshot answers (see Snapshot.h)
+    void near(const Location& latLng, int radius, std::vector<unsigned>& found) const;
+    void find(const std::string& text, std::vector<unsigned>& found) const;
+    void describe(std::ostream& out, unsigned r) const;
+    void stats(std::ostream& out) const;
+
+    size_t size() const { return restaurauntCount; }
+    // the string numbered id
+    const char* str(unsigned id) const { return chars + stringStarts[id]; }
+    size_t length(unsigned id) const { return stringStarts[id + 1] - stringStarts[id] - 1; }
+
+    // which snapshot this is, counting from 1 for the first one mapped
+    unsigned long long generation;
+
+private:
+    MappedSnapshot(const MappedSnapshot&);
+    MappedSnapshot& operator=(const MappedSnapshot&);
+
+    // checks the section numbered id is count (or any number, if count is 0) elements
+    // of width bytes, and returns where it starts, or NULL if it isn't
+    const void* section(unsigned id, size_t width, size_t& count) const;
+
+    // the mapping
+    const char* map;
+    size_t mapLength;
+
+    // the sections, pointing into the mapping
+    const MappedRestauraunt* restauraunts;
+    size_t restaurauntCount;
+    const unsigned long long* stringStarts;
+    size_t stringCount;
+    const char* chars;
+    const double* kdXs;
+    const double* kdYs;
+    const unsigned* kdItems;
+    const double* kdSplits;
+    const unsigned char* kdAxes;
+    const double* crimeLats;
+    const double* crimeLngs;
+    const int* crimeDays;
+    const unsigned char* crimeTypes;
+    const unsigned char* crimeWeapons;
+    size_t crimeCount;
+    const unsigned long long* linkStarts;
+    const unsigned* linkIds;
+    size_t linkCount;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/******************************************************************************
+ * Parse.cpp                                                                  *
+ *                                                                            *
+ * Number parsing for Fields, without sscanf, stof, or any of the locale      *
+ * machinery that comes along with them.                                      *
+ ******************************************************************************/
+
+#include "Parse.h"
+
+#include <cstdlib>
+
+// Powers of ten that are exactly representable as doubles
+static const double exactPowers[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+bool parseInt(const char*& p, const char* end, long long& out){
+    const char* s = p;
+    bool negative = false;
+    if(s < end && (*s == '-' || *s == '+')){
+        negative = *s == '-';
+        s++;
+    }
+    const char* digits = s;
+    long long value = 0;
+    while(s < end && (unsigned)(*s - '0') < 10){
+        value = value*10 + (*s - '0');
+        s++;
+    }
+    if(s == digits)
+        return false;
+    out = negative ? -value : value;
+    p = s;
+    return true;
+}
+
+// Every coordinate in the data is something like -71.1574123: at most 19 significant
+// digits and a small power of ten. In that case both the digits and the power of ten
+// are exact doubles, so a single division is correctly rounded (that is Clinger's fast
+// path) and gives exactly what strtod would. Anything else is left to strtod, which is
+// safe to call on a Field as they are always followed by a delimiter or a '\0'.
+bool parseDouble(const char*& p, const char* end, double& out){
+    const char* s = p;
+    bool negative = false;
+    if(s < end && (*s == '-' || *s == '+')){
+        negative = *s == '-';
+        s++;
+    }
+    unsigned long long mantissa = 0;
+    int digits = 0, fractionDigits = 0;
+    const char* start = s;
+    while(s < end && (unsigned)(*s - '0') < 10){
+        mantissa = mantissa*10 + (*s - '0');
+        digits++;
+        s++;
+    }
+    if(s < end && *s == '.'){
+        s++;
+        while(s < end && (unsigned)(*s - '0') < 10){
+            mantissa = mantissa*10 + (*s - '0');
+            digits++;
+            fractionDigits++;
+            s++;
+        }
+    }
+    if(digits == 0)
+        return false;
+    bool hasExponent = s < end && (*s == 'e' || *s == 'E');
+    if(!hasExponent && digits <= 19 && mantissa < (1ULL << 53) && fractionDigits <= 22){
+        double value = (double)mantissa / exactPowers[fractionDigits];
+        out = negative ? -value : value;
+        p = s;
+        return true;
+    }
+    // The slow path
+    char* after;
+    double value = strtod(start, &after);
+    if(after == start || after > end)
+        return false;
+    out = negative ? -value : value;
+    p = after;
+    return true;
+}
+
+bool parseInt(const Field& f, long long& out){
+    const char* p = f.begin;
+    return parseInt(p, f.end, out) && p == f.end;
+}
+
+bool parseDouble(const Field& f, double& out){
+    const char* p = f.begin;
+    return parseDouble(p, f.end, out) && p == f.end;
+}
@@ -0,0 +1,27 @@
+/******************************************************************************
+ * Parse.h                                                                    *
+ *                                                                            *
+ * Number parsing for Fields, without sscanf, stof, or any of the locale      *
+ * machinery that comes along with them. Decimal numbers of the sort that     *
+ * show up in the data (a handful of digits either side of the point) take a  *
+ * fast, exactly rounded path; anything stranger falls back on strtod.        *
+ ******************************************************************************/
+
+#ifndef PARSE
+#define PARSE
+
+#include "Field.h"
+
+// parses an optionally signed integer from the start of [p, end), advancing p past it.
+// Returns false if there were no digits.
+bool parseInt(const char*& p, const char* end, long long& out);
+
+// parses a decimal number (with optional sign, fraction, and exponent) from the start
+// of [p, end), advancing p past it. Returns false if there was no number.
+bool parseDouble(const char*& p, const char* end, double& out);
+
+// whole-field conveniences, returning false if the field isn't entirely a number
+bool parseInt(const Field& f, long long& out);
+bool parseDouble(const Field& f, double& out);
+
+#endif
@@ -11,6 +11,20 @@
  * function, which maps a function over all the elements of the QuadTree in   *
  * no particular order.                                                       *
  *                                                                            *
+ * Since then it has grown into something more like a query engine: nearest() *
+ * finds the k objects closest to a location (best first, expanding the       *
+ * nodes whose quadrants are closest first), remove() takes an object back    *
+ * out (for a license that has closed, say), and forEach() and forEachNear()  *
+ * visit objects with whatever lambda they are given, which the compiler can  *
+ * inline in a way it never could the old function pointer. None of these     *
+ * recurse: the tree is only as balanced as the order things were inserted    *
+ * in, and a bad order makes it deep enough to overflow the stack, so they    *
+ * all keep their own stack of nodes instead.                                 *
+ *                                                                            *
+ * The nodes all come out of an Arena belonging to the tree, and go when it   *
+ * does. The objects in the tree are only pointed to: they belong to whoever  *
+ * inserted them, and are never deleted by the tree.                          *
+ *                                                                            *
  * As a side note, on naming conventions: for regular C++ classes, I use      *
  * class.h and class.cpp as the header and source files, but for templated    *
  * classes this is all thrown to whack, so I indicate that the class is       *
@@ -21,7 +35,9 @@
 #ifndef QUADTREE
 #define QUADTREE
 
+#include "Arena.hpp"
 #include "Location.h"
+#include "SpatialIndex.hpp"
 #include <vector>
 
 template<class T>
@@ -31,9 +47,40 @@ struct QuadNode{
     T* data;
 };
 
+// The stack of nodes still to visit in a traversal. The first QUAD_STACK_SIZE nodes go
+// in a plain array, so the usual shallow traversal allocates nothing; only a
+// pathologically deep tree spills over into the vector.
+#define QUAD_STACK_SIZE 64
+
+template<class T>
+struct QuadStack{
+    struct QuadNode<T>* nodes[QUAD_STACK_SIZE];
+    int top;
+    std::vector<struct QuadNode<T>*> overflow;
+
+    QuadStack() : top(0) {}
+    bool empty() const { return top == 0 && overflow.empty(); }
+    void push(struct QuadNode<T>* node){
+        if(!node)
+            return;
+        if(top < QUAD_STACK_SIZE)
+            nodes[top++] = node;
+        else
+            overflow.push_back(node);
+    }
+    struct QuadNode<T>* pop(){
+        if(!overflow.empty()){
+            struct QuadNode<T>* node = overflow.back();
+            overflow.pop_back();
+            return node;
+        }
+        return nodes[--top];
+    }
+};
+
     
 template<class T>
-class QuadTree{
+class QuadTree : public SpatialIndex<T>{
 public:
     QuadTree();
     // Initialize the QuadTree with a root element
@@ -45,8 +92,25 @@ public:
     void insert(Location l, T* data);
     
     std::vector<T*> findNodes(Location l, int radius);
+    // the same, but appending to v, which can then be reused between queries
+    void findNodes(const Location& l, int radius, std::vector<T*>& v);
     
     void mapNodes( void (*mapFunction)(T*, void*), void* cl );
+    
+    // calls visit(object) for every object in the tree, in no particular order
+    template<class F>
+    void forEach(F visit);
+    
+    // calls visit(object) for every object strictly within radius of l
+    template<class F>
+    void forEachNear(const Location& l, double radius, F visit);
+    
+    // returns the (up to) k objects closest to l, closest first
+    std::vector<T*> nearest(const Location& l, size_t k);
+    
+    // takes the object data, inserted at l, back out of the tree (without deleting it),
+    // returning false if it wasn't there
+    bool remove(const Location& l, T* data);
 
     // Auxiliary Functions:
     // For insertion
@@ -54,18 +118,9 @@ public:
     void insertNode(struct QuadNode<T>* node, struct QuadNode<T>* toInsert);
     int comparePositions(Location a, Location b);
     
-    // for findNodes
-    void findNodesRecursive(struct QuadNode<T>* node, Location l, int radius, std::vector<T*>& v);
-    
-    // for mapNodes
-    void mapNodesRecursive(struct QuadNode<T>* node,  void (*mapFunction)(T*, void*), void* cl);
-    
-    // for the destructor
-    void deleteNode(struct QuadNode<T>* node);
-    
-    
-    // And lastly, the root of the QuadTree
+    // And lastly, the root of the QuadTree, and where all of its nodes live
     struct QuadNode<T>* root;
+    Arena<struct QuadNode<T> > nodes;
 };
 
 #include "QuadTree.tpp"
@@ -12,6 +12,7 @@
  * no particular order.                                                       *
  ******************************************************************************/
 
+#include <queue>
 
 // a few constructors:
 template<class T>
@@ -29,11 +30,12 @@ QuadTree<T>::QuadTree(Location l, T* rootData){
 // Creates a QuadNode out of a location and an object pointer
 template<class T>
 struct QuadNode<T>* QuadTree<T>::newNode(Location l, T* data){
-    struct QuadNode<T>* n = new struct QuadNode<T>;
+    struct QuadNode<T>* n = nodes.make();
     n->children[0] = n->children[1] =
         n->children[2] = n->children[3] = NULL;
     n->l = l;
     n->data = data;
+    return n;
 }
 
 // creates a QuadNode with newNode and inserts it into the tree with insertNode
@@ -73,55 +75,64 @@ int QuadTree<T>::comparePositions(Location a, Location b){
     return 3;
 }
 
-// A recursive function to insert the node toInsert into the subtree with a root at node
+// Inserts the node toInsert into the subtree with a root at node, walking down until
+// it finds an empty spot in the right quadrant
 template<class T>
 void QuadTree<T>::insertNode(struct QuadNode<T>* node, struct QuadNode<T>* toInsert){
-    char childIndex = comparePositions(node->l, toInsert->l);
-    if(node->children[childIndex] == NULL)
-        node->children[childIndex] = toInsert;
-    else
-        insertNode(node->children[childIndex], toInsert);
+    while(true){
+        int childIndex = comparePositions(node->l, toInsert->l);
+        if(node->children[childIndex] == NULL){
+            node->children[childIndex] = toInsert;
+            return;
+        }
+        node = node->children[childIndex];
+    }
 }
 
 // Calls the function mapFunction taking argument object pointer and void* for each
 // object in the quadtree and with the closure cl.
 template<class T>
 void QuadTree<T>::mapNodes( void (*mapFunction)(T*, void*), void* cl ){
-    mapNodesRecursive(root, mapFunction, cl);
+    forEach([&](T* data){ mapFunction(data, cl); });
 }
 
-// Recursively calls the function mapFunction taking argument object pointer and void*
-// for eac object in the quadtree and with the closure cl.
+// Calls visit for each object in the quadtree
 template<class T>
-void QuadTree<T>::mapNodesRecursive(struct QuadNode<T>* node,  void (*mapFunction)(T*, void*), void* cl){
-    if(node)
-        mapFunction(node->data, cl);
-    for(int i=0;i<4;i++)
-        if(node->children[i])
-            mapNodesRecursive(node->children[i], mapFunction, cl);
+template<class F>
+void QuadTree<T>::forEach(F visit){
+    QuadStack<T> stack;
+    stack.push(root);
+    while(!stack.empty()){
+        struct QuadNode<T>* node = stack.pop();
+        visit(node->data);
+        for(int i=3;i>=0;i--)
+            stack.push(node->children[i]);
+    }
 }
 
 // returns a vector of object pointers within a radius radius of the location l
 template<class T>
 std::vector<T*> QuadTree<T>::findNodes(Location l, int radius){
     std::vector<T*> v;
-    findNodesRecursive(root, l, radius, v);
+    findNodes(l, radius, v);
     return v;
 }
 
-// apparently I needed an abs function
-double abs(double x){
+template<class T>
+void QuadTree<T>::findNodes(const Location& l, int radius, std::vector<T*>& v){
+    forEachNear(l, radius, [&](T* data){ v.push_back(data); });
+}
+
+// apparently I needed an abs function (inline, as more than one file includes this)
+inline double abs(double x){
     return (x<0) ? -x : x;
 }
 
-// a recursive function to fund nodes in the subtree with a root at node that
-// are of a distance less than radius from the location l
-// If it finds any, it adds them to the referenced vector v
+// finds the nodes in the tree that are of a distance less than radius from the
+// location l, and calls visit on each one's object
 template<class T>
-void QuadTree<T>::findNodesRecursive(struct QuadNode<T>* node, 
-                                                Location l, 
-                                                int radius, 
-                                                std::vector<T*>& v){
+template<class F>
+void QuadTree<T>::forEachNear(const Location& l, double radius, F visit){
     /*Remember:
      * 
      ******|******
@@ -132,51 +143,149 @@ void QuadTree<T>::findNodesRecursive(struct QuadNode<T>* node,
      
      NE = 0, NW = 1, SW = 2, SE = 4
      */
-    if(node == NULL)
-        return;
-
-    bool withinX = abs(node->l.x - l.x) < radius;
-    bool withinY = abs(node->l.y - l.y) < radius;
-    if(withinX && withinY){
-        if(node->l.distSquared(l) < radius*radius){
-            v.push_back(node->data);
-        }
-        for(int i=0;i<4;i++)
-            if(node->children[i])
-                findNodesRecursive(node->children[i], l, radius, v);
-    }else if(withinX){
-        if(node->l.y < l.y){
-            findNodesRecursive(node->children[0], l, radius, v);
-            findNodesRecursive(node->children[1], l, radius, v);
+    // children are pushed last first so they come off the stack in the same order
+    // the old recursive version visited them
+    QuadStack<T> stack;
+    stack.push(root);
+    while(!stack.empty()){
+        struct QuadNode<T>* node = stack.pop();
+        bool withinX = abs(node->l.x - l.x) < radius;
+        bool withinY = abs(node->l.y - l.y) < radius;
+        if(withinX && withinY){
+            if(node->l.distSquared(l) < radius*radius){
+                visit(node->data);
+            }
+            for(int i=3;i>=0;i--)
+                stack.push(node->children[i]);
+        }else if(withinX){
+            if(node->l.y < l.y){
+                stack.push(node->children[1]);
+                stack.push(node->children[0]);
+            }else{
+                stack.push(node->children[3]);
+                stack.push(node->children[2]);
+            }
+        }else if(withinY){
+            if(node->l.x < l.x){
+                stack.push(node->children[3]);
+                stack.push(node->children[0]);
+            }else{
+                stack.push(node->children[2]);
+                stack.push(node->children[1]);
+            }
         }else{
-            findNodesRecursive(node->children[2], l, radius, v);
-            findNodesRecursive(node->children[3], l, radius, v);
+            stack.push(node->children[comparePositions(node->l, l)]);
         }
-    }else if(withinY){
-        if(node->l.x < l.x){
-            findNodesRecursive(node->children[0], l, radius, v);
-            findNodesRecursive(node->children[3], l, radius, v);
-        }else{
-            findNodesRecursive(node->children[1], l, radius, v);
-            findNodesRecursive(node->children[2], l, radius, v);
-        }
-    }else{
-        findNodesRecursive(node->children[comparePositions(node->l, l)], l, radius, v);
-    }    
+    }
 }
 
-// The destructor merely calls deleteNode for the root node. 
+// A best first search: nodes wait in a priority queue ordered by how close the
+// quadrant they cover comes to l, and the closest k objects seen so far are kept in a
+// second (max) heap. Once the closest quadrant left is further away than the kth
+// closest object, nothing left can make the cut.
 template<class T>
-QuadTree<T>::~QuadTree(){
-    if(root!=NULL)
-        deleteNode(root);
+std::vector<T*> QuadTree<T>::nearest(const Location& l, size_t k){
+    // the area a node's subtree covers
+    struct Region{
+        double minX, maxX, minY, maxY;
+    };
+    struct Candidate{
+        double dist;
+        struct QuadNode<T>* node;
+        Region region;
+        bool operator<(const Candidate& c) const { return dist > c.dist; }
+    };
+    struct Found{
+        double dist;
+        T* data;
+        bool operator<(const Found& f) const { return dist < f.dist; }
+    };
+    std::vector<T*> result;
+    if(!root || k == 0)
+        return result;
+
+    const double inf = 1e300;
+    std::priority_queue<Candidate> candidates;
+    std::priority_queue<Found> found;
+    Candidate start = {0, root, {-inf, inf, -inf, inf}};
+    candidates.push(start);
+    while(!candidates.empty()){
+        Candidate c = candidates.top();
+        candidates.pop();
+        if(found.size() == k && c.dist >= found.top().dist)
+            break;
+        struct QuadNode<T>* node = c.node;
+        Found f = {node->l.distSquared(l), node->data};
+        if(found.size() < k){
+            found.push(f);
+        }else if(f.dist < found.top().dist){
+            found.pop();
+            found.push(f);
+        }
+        // each child covers one quadrant of its parent's region, split at the node
+        for(int i=0;i<4;i++){
+            if(!node->children[i])
+                continue;
+            Region r = c.region;
+            if(i == 0 || i == 3)
+                r.minX = node->l.x;
+            else
+                r.maxX = node->l.x;
+            if(i == 0 || i == 1)
+                r.minY = node->l.y;
+            else
+                r.maxY = node->l.y;
+            double dx = l.x < r.minX ? r.minX - l.x : (l.x > r.maxX ? l.x - r.maxX : 0);
+            double dy = l.y < r.minY ? r.minY - l.y : (l.y > r.maxY ? l.y - r.maxY : 0);
+            Candidate child = {dx*dx + dy*dy, node->children[i], r};
+            candidates.push(child);
+        }
+    }
+    result.resize(found.size());
+    for(size_t i=found.size();i>0;i--){
+        result[i-1] = found.top().data;
+        found.pop();
+    }
+    return result;
 }
 
-// deleteNode deletes the data of a node and recurses on such children as it has
+// Finds the node holding data by following the path it would have been inserted down,
+// unhooks it, and reinserts everything that was underneath it (the nodes themselves
+// are reused, so this never allocates). The node is given back to the arena.
 template<class T>
-void QuadTree<T>::deleteNode(struct QuadNode<T>* node){
-    delete node->data;
+bool QuadTree<T>::remove(const Location& l, T* data){
+    struct QuadNode<T>** link = &root;
+    while(*link && (*link)->data != data)
+        link = &(*link)->children[comparePositions((*link)->l, l)];
+    struct QuadNode<T>* node = *link;
+    if(!node)
+        return false;
+    *link = NULL;
+
+    // the orphans are reinserted in breadth first order, parents before children,
+    // which keeps the shape of the subtree roughly as it was
+    std::vector<struct QuadNode<T>*> orphans;
     for(int i=0;i<4;i++)
         if(node->children[i])
-            deleteNode(node->children[i]);
-}
\ No newline at end of file
+            orphans.push_back(node->children[i]);
+    for(size_t i=0;i<orphans.size();i++){
+        struct QuadNode<T>* orphan = orphans[i];
+        for(int j=0;j<4;j++){
+            if(orphan->children[j])
+                orphans.push_back(orphan->children[j]);
+            orphan->children[j] = NULL;
+        }
+        if(!root)
+            root = orphan;
+        else
+            insertNode(root, orphan);
+    }
+    nodes.recycle(node);
+    return true;
+}
+
+// The nodes go with the arena, and the objects belong to someone else, so there is
+// nothing left to do here
+template<class T>
+QuadTree<T>::~QuadTree(){
+}
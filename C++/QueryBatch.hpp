@@ -0,0 +1,71 @@
+/******************************************************************************
+ * QueryBatch.hpp                                                             *
+ *                                                                            *
+ * A batch of radius queries and the answers to them. Asking a spatial index  *
+ * about one crime at a time, in file order, sends every query off to some    *
+ * unrelated corner of the index, and each answer used to be a brand new      *
+ * vector. A QueryBatch instead hands the index a whole block of locations at *
+ * once, sorted along a Morton (Z order) curve so that neighbouring queries   *
+ * are near each other, and the index can answer all of them in one walk.     *
+ *                                                                            *
+ * The answers are kept compressed sparse row style: one array of every       *
+ * object found, ordered by query, and one of where each query's objects      *
+ * start. The batch belongs to the caller and is meant to be reused, so once  *
+ * its vectors have grown big enough nothing is allocated at all.             *
+ ******************************************************************************/
+
+#ifndef QUERY_BATCH
+#define QUERY_BATCH
+
+#include <cstddef>
+#include <vector>
+
+#include "Location.h"
+
+template<class T>
+class QueryBatch{
+public:
+    QueryBatch();
+
+    // the number of queries in the batch
+    size_t size() const { return queries; }
+    // how many objects were found for query i, and the first of them
+    size_t count(size_t i) const { return starts[i + 1] - starts[i]; }
+    T* const* results(size_t i) const { return objects.data() + starts[i]; }
+
+    // For the indexes answering the batch:
+
+    // starts a new batch of the n queries at (xs[i], ys[i]), working out the order to
+    // answer them in
+    void reset(const double* xs, const double* ys, size_t n);
+    // records that object was found for query
+    void add(unsigned query, T* object){
+        Found f = {query, object};
+        found.push_back(f);
+    }
+    // sorts everything found by query, once every query has been answered
+    void finish();
+
+    // the queries in Morton order
+    std::vector<unsigned> order;
+    // scratch space for the indexes, which they can use as they please
+    std::vector<unsigned> subset;
+    std::vector<T*> scratch;
+
+private:
+    struct Found{
+        unsigned query;
+        T* object;
+    };
+
+    size_t queries;
+    std::vector<unsigned long long> keys;
+    std::vector<Found> found;
+    // query i's objects are objects[starts[i]] up to objects[starts[i + 1]]
+    std::vector<unsigned> starts;
+    std::vector<T*> objects;
+};
+
+#include "QueryBatch.tpp"
+
+#endif
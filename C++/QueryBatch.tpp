@@ -0,0 +1,72 @@
+/******************************************************************************
+ * QueryBatch.tpp                                                             *
+ *                                                                            *
+ * A reusable batch of radius queries, sorted along a Morton curve, and the   *
+ * objects found for each of them.                                            *
+ ******************************************************************************/
+
+#include <algorithm>
+
+template<class T>
+QueryBatch<T>::QueryBatch(){
+    queries = 0;
+    starts.assign(1, 0);
+}
+
+// spreads the low 16 bits of x out to the even bits, so that two of them can be
+// interleaved into a Morton code
+inline unsigned long long spreadBits(unsigned long long x){
+    x &= 0xFFFF;
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+// Each query's location is scaled onto a 65536 x 65536 grid over the batch's bounding
+// box, its x and y bits are interleaved, and the queries are sorted by that. The
+// query number goes in the low bits of the key so a plain sort of the keys does it.
+template<class T>
+void QueryBatch<T>::reset(const double* xs, const double* ys, size_t n){
+    queries = n;
+    found.clear();
+    order.resize(n);
+    if(n == 0)
+        return;
+
+    double minX = xs[0], maxX = minX, minY = ys[0], maxY = minY;
+    for(size_t i=1;i<n;i++){
+        minX = std::min(minX, xs[i]); maxX = std::max(maxX, xs[i]);
+        minY = std::min(minY, ys[i]); maxY = std::max(maxY, ys[i]);
+    }
+    double scaleX = maxX > minX ? 65535/(maxX - minX) : 0;
+    double scaleY = maxY > minY ? 65535/(maxY - minY) : 0;
+
+    keys.resize(n);
+    for(size_t i=0;i<n;i++){
+        unsigned long long x = (unsigned long long)((xs[i] - minX)*scaleX);
+        unsigned long long y = (unsigned long long)((ys[i] - minY)*scaleY);
+        keys[i] = ((spreadBits(x) | (spreadBits(y) << 1)) << 32) | i;
+    }
+    std::sort(keys.begin(), keys.end());
+    for(size_t i=0;i<n;i++)
+        order[i] = (unsigned)keys[i];
+}
+
+// A counting sort by query. Counting into starts[q + 2] and then handing out places
+// with starts[q + 1]++ leaves starts[q] pointing at the first of query q's objects,
+// without needing a second array. It's stable, so each query's objects stay in the
+// order they were found.
+template<class T>
+void QueryBatch<T>::finish(){
+    starts.assign(queries + 2, 0);
+    for(const Found& f : found)
+        starts[f.query + 2]++;
+    for(size_t i=2;i<queries + 2;i++)
+        starts[i] += starts[i - 1];
+    objects.resize(found.size());
+    for(const Found& f : found)
+        objects[starts[f.query + 1]++] = f.object;
+    starts.resize(queries + 1);
+}
@@ -12,62 +12,67 @@
 
 using namespace std;
 
+#include <cmath>
+
+StringPool Restauraunt::strings;
+
 Restauraunt::Restauraunt(){
+    lat = lng = 0;
+    name = address = description = 0;
     crimeCost = 0;
+    id = 0;
 }
 
 // return true if the location has been set
 bool Restauraunt::locationSet(){
-    return latLng.isSet();
+    return lat != 0;
+}
+
+// sets the location to a given location, rounded to the nearest fixed point unit
+void Restauraunt::setLocation(const Location& l){
+    lat = (int)lround(l.x*FIXED_PER_DEGREE);
+    lng = (int)lround(l.y*FIXED_PER_DEGREE);
 }
 
-// sets the location to a given location, updating the metric location as well
-void Restauraunt::setLocation(Location& l){
-    latLng.setLocation(l);
-    metricLocation.setLocation((latLng.x - MIN_LAT)*LAT_TO_METERS , 
-                               (latLng.y - MIN_LNG)*LNG_TO_METERS);
+Location Restauraunt::latLng() const{
+    return Location((double)lat/FIXED_PER_DEGREE, (double)lng/FIXED_PER_DEGREE);
 }
 
-// adds a crime to the list of crimes stored in the vector crimes,
-// and updates the crimeCost with a calculation based on time, distance to
-// the crime, and crime type (with weapons and shootings
-void Restauraunt::addCrime(struct Crime* c, const Location& crimeLoc, int initialCost, const Date& now){
-    crimeCost += finalCrimeCost(c->date, date, now, crimeLoc, metricLocation, initialCost);
-    crimes.push_back(c);
-    c->copies ++;
+Location Restauraunt::metricLocation() const{
+    Location l = latLng();
+    return Location((l.x - MIN_LAT)*LAT_TO_METERS , 
+                    (l.y - MIN_LNG)*LNG_TO_METERS);
 }
 
 //input from CSV
-istream& operator>>(istream  &input, Restauraunt& r){
-    // Each input.getline gets another cell from the CSV table. The column
-    // the cell belongs to is shown in the comments
-    char buff[128];
-    input.getline(buff, 128, ','); // BusinessName
+CsvReader& operator>>(CsvReader &input, Restauraunt& r){
+    // The row is read in one go, and each of the fields points straight at a cell
+    // of the CSV table. The column the cell belongs to is shown in the comments
+    // (rows that are missing cells are skipped entirely)
+    while(input.readRow() && input.size() < 13)
+        ;
     if(input.eof())
         return input;
-    r.name = string(buff);
-    input.getline(buff, 128, ','); // DBAName, whatever that means
-    input.getline(buff, 128, ','); // Address
-    r.address = string(buff) + ' ';
-    input.getline(buff, 128, ','); // City
-    r.address += string(buff) + ", ";
-    input.getline(buff, 128, ','); // State
-    r.address += string(buff) + ", ";
-    input.getline(buff, 128, ','); // Zip
-    r.address += string(buff);
-    input.getline(buff, 128, ','); // LICSTATUS
-    input.getline(buff, 128, ','); // LICENSECAT
-    input.getline(buff, 128, ','); // description
-    r.description = string(buff);
-    input.getline(buff, 128, ','); // date
-    r.date.setDate(buff);
-    input.getline(buff, 128, ','); // phone
-    input.getline(buff, 128, ','); // property id
-    input.getline(buff, 128); // location
-    r.latLng.setLocation(buff);
-    if(r.latLng.x != 0)
-        r.metricLocation.setLocation((r.latLng.x - MIN_LAT)*LAT_TO_METERS , 
-                                     (r.latLng.y - MIN_LNG)*LNG_TO_METERS);
+    StringPool& strings = Restauraunt::strings;
+    r.name = strings.intern(input[0]); // BusinessName
+    // [1] DBAName, whatever that means
+    // The address is pieced together right in the pool
+    strings.start();
+    strings.append(input[2]); // Address
+    strings.append(" ");
+    strings.append(input[3]); // City
+    strings.append(", ");
+    strings.append(input[4]); // State
+    strings.append(", ");
+    strings.append(input[5]); // Zip
+    r.address = strings.finish();
+    // [6] LICSTATUS, [7] LICENSECAT
+    r.description = strings.intern(input[8]); // description
+    r.date.setDate(input[9]); // date
+    // [10] phone, [11] property id
+    Location l;
+    l.setLocation(input[12]); // location
+    r.setLocation(l);
     return input;
 }   
 
@@ -93,15 +98,35 @@ string stringReplace(string s, string query, string replacement){
 }
 
 //output as CSV with header "Location, Name, Date, Address, Description, CrimeCost
-ostream& operator<<(ostream  &output, Restauraunt& r){
-    output <<'"'<< r.latLng << "\", \"" << stringReplace(r.name, "\"", "\\\"")
-           << "\", " << r.date << ", \"" << stringReplace(r.address , "\"", "\\\"")
-           << "\", \"" << stringReplace(r.description, "\"", "\\\"") 
-           << "\", " << r.crimeCost << ", ";
-    for(struct Crime* c : r.crimes){
-        output << '|' << c->date <<'~' << int(c->type) << '~' << int(c->weapon);
+void Restauraunt::write(ostream  &output, const CrimeTable& table, const CrimeLinks& links){
+    Location l = latLng();
+    output <<'"'<< l << "\", \"" << stringReplace(strings.string(name), "\"", "\\\"")
+           << "\", " << date << ", \"" << stringReplace(strings.string(address) , "\"", "\\\"")
+           << "\", \"" << stringReplace(strings.string(description), "\"", "\\\"") 
+           << "\", " << crimeCost << ", ";
+    // crimes with no date don't count, and the site reads the oldest year off the first
+    links.forEach(id, [&](unsigned c){
+        if(table.days[c] == INVALID_DAY)
+            return;
+        output << '|' << table.date(c) <<'~' << int(table.types[c]) << '~'
+               << int(table.weapons[c]);
+    });
+    // (not endl, which would flush the stream for every restauraunt)
+    output << '\n';
+}
+
+void Restauraunt::writeQuoted(ostream &output, const char* s){
+    output << '"';
+    for(;*s;s++){
+        if(*s == '"')
+            output << '"';
+        output << *s;
     }
-    output << endl;
+    output << '"';
+}
 
-    return output;
-}
\ No newline at end of file
+void Restauraunt::writeKey(ostream &output) const{
+    writeQuoted(output, strings.str(name));
+    output << ", ";
+    writeQuoted(output, strings.str(address));
+}
@@ -6,6 +6,11 @@
  * Desribing a simple class Restauraunt to hold name, address, and description of a     *
  * restauraunt in addition to it's position and a list of the crimes commited           *
  * nearby.                                                                              *
+ *                                                                                      *
+ * There are a lot of restauraunts, so each is kept small: the strings are numbers in   *
+ * Restauraunt::strings (a StringPool shared by every restauraunt), and the location is *
+ * stored in fixed point, as whole 1e-7ths of a degree (about a centimeter), in two     *
+ * ints. The metric location is worked out from that whenever it is asked for.          *
  ****************************************************************************************/
 
 
@@ -19,6 +24,10 @@
 #include "Location.h"
 #include "Date.h"
 #include "Crime.h"
+#include "CrimeLinks.h"
+#include "CrimeTable.h"
+#include "CsvReader.h"
+#include "StringPool.h"
 
 #define MIN_LAT 42.237125
 #define MAX_LAT 42.393484
@@ -29,6 +38,9 @@
 #define LAT_TO_METERS 111080
 #define LNG_TO_METERS 364437
 
+// how many of the fixed point units locations are stored in make up a degree
+#define FIXED_PER_DEGREE 10000000
+
 class Restauraunt{
 public:
     Restauraunt();
@@ -36,30 +48,38 @@ public:
     // return true if the location has been set
     bool locationSet();
     
-    // sets the location to a given location, updating the metric location as well
-    void setLocation(Location& l);
-    
-    // adds a crime to the list of crimes stored in the vector crimes,
-    // and updates the crimeCost with a calculation based on time, distance to
-    // the crime, and crime type (with weapons and shootings
-    void addCrime(struct Crime* c, const Location& l, int initialCost, const Date& now);
+    // sets the location to a given location
+    void setLocation(const Location& l);
     
+    // latLng is simply the latitudinal/longitudinal coordinats, whereas metricLocation
+    // is coordinates in meters from the minimum latitude and longitude in the data
+    Location latLng() const;
+    Location metricLocation() const;
     
     // These are important functions, for both the reading in of a restauraunt from a 
     // line in the city of Boston's data on restauraunts (in .csv form), and outputting
-    // a line of my own .csv
-    friend std::istream &operator>>(std::istream  &input, Restauraunt& r);
+    // a line of my own .csv (which needs the crimes, and which of them are nearby)
+    friend CsvReader &operator>>(CsvReader &input, Restauraunt& r);
+    
+    void write(std::ostream &output, const CrimeTable& table, const CrimeLinks& links);
     
-    friend std::ostream &operator<<(std::ostream  &output, Restauraunt& r);
+    // For the other CSVs written a row per restauraunt: writes the name and address as
+    // the first two cells of the row, quoted properly (with any quotes in them doubled),
+    // and the same for any string s
+    void writeKey(std::ostream &output) const;
+    static void writeQuoted(std::ostream &output, const char* s);
     
-    // metricLocation is coordinates in meters from the minimum latitude and longitude
-    // in the data, whereas latLng is simply the latitudinal/longitudinal coordinats
-    Location latLng, metricLocation;
-    std::string name, address, description;
+    // the location, in fixed point (see above)
+    int lat, lng;
+    // numbers of strings in the pool
+    unsigned name, address, description;
     int crimeCost;
-    std::vector<struct Crime*> crimes;
     Date date;
+    // the order in which the restauraunt was read, for indexing arrays of restauraunts
+    int id;
     
+    // the names, addresses and descriptions of every restauraunt
+    static StringPool strings;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+/******************************************************************************
+ * Rings.cpp                                                                  *
+ *                                                                            *
+ * The crimes around each restauraunt, counted and costed by how far away     *
+ * they were.                                                                 *
+ ******************************************************************************/
+
+#include "Rings.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+Rings::Rings(){
+    halfDistance = 0;
+}
+
+bool Rings::parse(const char* list){
+    radii.clear();
+    const char* p = list;
+    while(*p){
+        char* end;
+        long radius = strtol(p, &end, 10);
+        if(end == p || radius <= 0 || radius > MAX_RADIUS ||
+           (!radii.empty() && radius <= radii.back()))
+            return false;
+        radii.push_back((int)radius);
+        p = end;
+        if(*p == ',')
+            p++;
+        else if(*p)
+            return false;
+    }
+    return !radii.empty();
+}
+
+void Rings::reset(size_t n){
+    counts.assign(n*size(), 0);
+    costs.assign(n*size(), 0);
+}
+
+void Rings::add(const Rings& other){
+    for(size_t i=0;i<counts.size();i++){
+        counts[i] += other.counts[i];
+        costs[i] += other.costs[i];
+    }
+}
+
+// The header names each ring by the distances it covers, like "Crimes 50-100m"
+void Rings::write(ostream& out, const vector<Restauraunt*>& restauraunts) const{
+    out << "Name, Address";
+    for(size_t ring=0;ring<size();ring++){
+        int inner = ring ? radii[ring - 1] : 0;
+        out << ", Crimes " << inner << '-' << radii[ring] << "m"
+            << ", Cost " << inner << '-' << radii[ring] << "m";
+    }
+    out << '\n';
+    for(size_t i=0;i<restauraunts.size();i++){
+        restauraunts[i]->writeKey(out);
+        for(size_t ring=0;ring<size();ring++){
+            size_t at = restauraunts[i]->id*size() + ring;
+            out << ", " << counts[at] << ", " << (double)costs[at]/RING_COST_SCALE;
+        }
+        out << '\n';
+    }
+}
@@ -0,0 +1,80 @@
+/******************************************************************************
+ * Rings.h                                                                    *
+ *                                                                            *
+ * The crime cost only ever counts crimes within CRIME_RADIUS, and doesn't    *
+ * care how close within it they were. Rings break the crimes around each     *
+ * restauraunt down by distance instead: given radii like 50, 100 and 250     *
+ * meters, every restauraunt gets the number of crimes, and what they cost,   *
+ * closer than 50 meters, from 50 to 100, and from 100 to 250.                *
+ *                                                                            *
+ * They are all found in one more pass over the crimes, looking each one up   *
+ * in the spatial index at the largest radius and sorting what is found into  *
+ * rings by how far away it is (see CrimeIngest::scoreRings), rather than one *
+ * run of the whole program per radius. Optionally, each crime's cost can     *
+ * also be weighed by its distance, halving every so many meters.             *
+ *                                                                            *
+ * Costs are added up in thousandths, as whole numbers, so that they come out *
+ * the same whatever order the threads add them in.                           *
+ ******************************************************************************/
+
+#ifndef RINGS
+#define RINGS
+
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+#include "Restauraunt.h"
+
+// costs are added up in units of 1/RING_COST_SCALE
+#define RING_COST_SCALE 1000
+
+class Rings{
+public:
+    Rings();
+
+    // Reads the radii from a list like "50,100,250" (in meters, increasing, up to
+    // MAX_RADIUS), returning false if it isn't one
+    bool parse(const char* radii);
+    // weighs each crime's cost by how far it was, halving every meters meters (or
+    // not at all, if 0)
+    void setDistanceDecay(double meters) { halfDistance = meters; }
+
+    // how many rings there are, and the largest radius
+    size_t size() const { return radii.size(); }
+    int outer() const { return radii.empty() ? 0 : radii.back(); }
+
+    // the ring a crime distance meters away falls in
+    size_t ringOf(double distance) const {
+        size_t ring = 0;
+        while(ring + 1 < radii.size() && distance >= radii[ring])
+            ring++;
+        return ring;
+    }
+    // what a crime distance meters away is weighed by
+    double weight(double distance) const {
+        return halfDistance > 0 ? exp2(-distance/halfDistance) : 1;
+    }
+
+    // makes room for the totals of n restauraunts, all 0
+    void reset(size_t n);
+    // adds a crime costing cost (already weighed) to ring of restauraunt r
+    void add(size_t r, size_t ring, double cost) {
+        counts[r*size() + ring]++;
+        costs[r*size() + ring] += llround(cost*RING_COST_SCALE);
+    }
+    // adds in the totals of other, which has the same rings
+    void add(const Rings& other);
+
+    // writes a row for each restauraunt, with the count and cost of each ring
+    void write(std::ostream& out, const std::vector<Restauraunt*>& restauraunts) const;
+
+private:
+    std::vector<int> radii;
+    double halfDistance;
+    // the totals of each ring of each restauraunt, [r*size() + ring]
+    std::vector<unsigned> counts;
+    std::vector<long long> costs;
+};
+
+#endif
@@ -0,0 +1,176 @@
+/******************************************************************************
+ * Snapshot.cpp                                                               *
+ *                                                                            *
+ * Everything built from one version of the licence and crime files.          *
+ ******************************************************************************/
+
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "CsvReader.h"
+#include "GeoCache.h"
+#include "Indexes.h"
+
+using namespace std;
+
+Snapshot::Snapshot(const SnapshotSettings& settings) : settings(settings){
+    index = makeIndex(settings.indexName);
+    crimes = NULL;
+    generation = 1;
+}
+
+// The index only points at the restauraunts (which go along with their arena), and
+// the crimes belong to the CrimeIngest, so nothing is freed twice
+Snapshot::~Snapshot(){
+    delete crimes;
+    delete index;
+}
+
+// The number of addresses missing from the geocode cache that are listed by name, before
+// the rest are just counted
+#define MISSES_LISTED 5
+
+// builds the spatial index! and reads in all of the restauraunts.
+// I constructed the restauraunt class so as to simply use the >> operator
+// to read a line from the CSV file
+void Snapshot::readRestauraunts(ostream& log){
+    GeoCache geocodes;
+    if(!geocodes.open(settings.geocodeFile.c_str()))
+        log << "Could not read the geocode cache " << settings.geocodeFile
+            << ", so no restauraunt without a location will get one\n";
+    size_t misses = 0;
+    Restauraunt* r = arena.make();
+    CsvReader foodFile(settings.foodFile.c_str());
+    foodFile.skipRow(); // Ignore first line
+    while(!(foodFile >> (*r)).eof()){
+        // If the location wasn't set, use the address to find the location, which is left
+        // unset (at 0, 0) if the address was never geocoded
+        if(!r->locationSet()){
+            const char* address = Restauraunt::strings.str(r->address);
+            Location l(0, 0);
+            if(!geocodes.find(address, address + Restauraunt::strings.length(r->address), l) &&
+               misses++ < MISSES_LISTED && geocodes.size())
+                log << "No location for " << Restauraunt::strings.string(r->address) << '\n';
+            r->setLocation(l);
+        }
+        // Which means that now the metric location of the restauraunt is known, 
+        // and can be inserted into the index
+        index->insert(r->metricLocation(), r);
+        r->id = restauraunts.size();
+        restauraunts.push_back(r);
+        r = arena.make();
+    }
+    arena.recycle(r);
+    if(misses)
+        log << misses << " restauraunts have no location and an address that isn't in "
+            << settings.geocodeFile << " (run python/locationFinder.py to look them up)" << endl;
+}
+
+bool Snapshot::readLayers(ostream& log){
+    if(settings.layerFile.empty())
+        return true;
+    if(!layers.load(settings.layerFile.c_str()))
+        return false;
+    layers.read(log);
+    return true;
+}
+
+// The types already numbered on earlier runs keep their numbers, and the costs are the
+// weights the analysts have settled on this week
+void Snapshot::readTypesAndCosts(ostream& log){
+    types.load(settings.typeFile.c_str());
+    for(const string& name : settings.excluded)
+        types.exclude(name.c_str());
+    if(!costs.load(settings.costFile.c_str()))
+        log << "No cost file at " << settings.costFile << ", so using the default costs\n";
+    crimes = new CrimeIngest(*index, restauraunts, types, costs, settings.threads);
+    crimes->log = &log;
+    if(layers.size() > 0)
+        crimes->addLayers(layers);
+}
+
+bool Snapshot::readCrimes(ostream& log){
+    const char* path = settings.crimeFile.c_str();
+    if(!(settings.pipeline ? crimes->runPipeline(path, log) : crimes->run(path)))
+        return false;
+    crimes->score();
+    if(types.changed() && !types.save(settings.typeFile.c_str()))
+        log << "Could not save the incident types to " << settings.typeFile << endl;
+    return true;
+}
+
+Snapshot* Snapshot::build(const SnapshotSettings& settings, ostream& log){
+    Snapshot* snapshot = new Snapshot(settings);
+    if(!snapshot->index){
+        delete snapshot;
+        return NULL;
+    }
+    snapshot->readRestauraunts(log);
+    snapshot->index->build();
+    if(!snapshot->readLayers(log)){
+        log << "Could not read " << settings.layerFile << endl;
+        delete snapshot;
+        return NULL;
+    }
+    snapshot->readTypesAndCosts(log);
+    if(!snapshot->readCrimes(log)){
+        log << "Could not read " << settings.crimeFile << endl;
+        delete snapshot;
+        return NULL;
+    }
+    return snapshot;
+}
+
+// (ties go by the order they were read in, so the answer is always the same)
+static bool nearer(const pair<double, unsigned>& a, const pair<double, unsigned>& b){
+    return a.first < b.first || (a.first == b.first && a.second < b.second);
+}
+
+void Snapshot::near(const Location& latLng, int radius, vector<unsigned>& found) const{
+    Location l((latLng.x - MIN_LAT)*LAT_TO_METERS, (latLng.y - MIN_LNG)*LNG_TO_METERS);
+    vector<Restauraunt*> within;
+    index->findNodes(l, radius, within);
+    vector<pair<double, unsigned> > byDistance;
+    for(Restauraunt* r : within){
+        Location m = r->metricLocation();
+        byDistance.push_back(make_pair(hypot(m.x - l.x, m.y - l.y), (unsigned)r->id));
+    }
+    sort(byDistance.begin(), byDistance.end(), nearer);
+    found.clear();
+    for(const pair<double, unsigned>& p : byDistance)
+        found.push_back(p.second);
+}
+
+void Snapshot::find(const string& text, vector<unsigned>& found) const{
+    found.clear();
+    auto sameLetter = [](char a, char b){ return tolower((unsigned char)a) == tolower((unsigned char)b); };
+    for(Restauraunt* r : restauraunts){
+        const char* name = Restauraunt::strings.str(r->name);
+        const char* end = name + Restauraunt::strings.length(r->name);
+        if(search(name, end, text.begin(), text.end(), sameLetter) != end)
+            found.push_back(r->id);
+    }
+}
+
+// The links are in date order, so the latest crime is the last
+void Snapshot::describe(ostream& out, unsigned id) const{
+    const Restauraunt* r = restauraunts[id];
+    Location l = r->latLng();
+    r->writeKey(out);
+    out << ", \"" << l << "\", " << r->crimeCost << ", " << crimes->links.count(id) << ", ";
+    int last = -1;
+    crimes->links.forEach(id, [&](unsigned crime){ last = (int)crime; });
+    if(last < 0)
+        out << "never";
+    else
+        out << crimes->table.date(last);
+    out << '\n';
+}
+
+void Snapshot::stats(ostream& out) const{
+    out << restauraunts.size() << " restauraunts, " << crimes->table.size() << " crimes, "
+        << crimes->links.links() << " links";
+}
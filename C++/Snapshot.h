@@ -0,0 +1,103 @@
+/******************************************************************************
+ * Snapshot.h                                                                 *
+ *                                                                            *
+ * Everything built from one version of the licence and crime files: the      *
+ * restauraunts (and the arena they live in), the spatial index over them,    *
+ * any other layers of places, the incident types and costs, and the crimes   *
+ * and their links to the restauraunts and places, all scored.                *
+ *                                                                            *
+ * A normal run builds one, writes the CSVs from it and is done. Serving      *
+ * (./analyze --serve) keeps one around to answer queries from instead, and   *
+ * when asked to reload builds a whole new one on a background thread, from   *
+ * whatever the files hold by then, and swaps it in through an EpochPointer.  *
+ * Queries carry on being answered from the old snapshot while the new one is *
+ * built, and a snapshot is never changed once it has been swapped in, so     *
+ * answering one never needs a lock. (The one thing snapshots share is        *
+ * Restauraunt::strings, which can be read while it is being added to.)       *
+ ******************************************************************************/
+
+#ifndef SNAPSHOT
+#define SNAPSHOT
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Crime.h"
+#include "CrimeIngest.h"
+#include "Layers.h"
+#include "Location.h"
+#include "Restauraunt.h"
+#include "SpatialIndex.hpp"
+#include "TypeDictionary.h"
+
+// where everything a snapshot is built from is, and how to build it
+struct SnapshotSettings{
+    std::string foodFile, crimeFile, geocodeFile, typeFile, costFile;
+    // the layer file (see Layers.h), if there are any other places to score
+    std::string layerFile;
+    std::string indexName;
+    // the incident types left out of the scoring
+    std::vector<std::string> excluded;
+    int threads;
+    bool pipeline;
+};
+
+class Snapshot{
+public:
+    // makes the (empty) spatial index named in settings; index is NULL if there is no
+    // such index
+    Snapshot(const SnapshotSettings& settings);
+   ~Snapshot();
+
+    // The steps of building a snapshot, in order. readRestauraunts reads every
+    // restauraunt, filling in the missing locations from the geocode cache (see
+    // GeoCache.h), and puts them in the index; readLayers reads the places of every layer in the layer file;
+    // readTypesAndCosts reads the incident types and crime costs and makes crimes,
+    // ready to be run. Progress and problems are printed to log
+    void readRestauraunts(std::ostream& log);
+    // (returns false if there is a layer file but it couldn't be read)
+    bool readLayers(std::ostream& log);
+    void readTypesAndCosts(std::ostream& log);
+    // runs crimes over the crime file (with the pipeline if the settings say so) and
+    // scores every restauraunt, saving any new incident types. Returns false if the
+    // crime file couldn't be read
+    bool readCrimes(std::ostream& log);
+
+    // Builds a whole snapshot from the files, one step after the other, returning NULL
+    // if it couldn't be
+    static Snapshot* build(const SnapshotSettings& settings, std::ostream& log);
+
+    // The queries served, which a MappedSnapshot answers just the same. Restauraunts
+    // are known by their ids. near finds the restauraunts within radius meters of the
+    // latitude and longitude latLng, nearest first, and find those with text in their
+    // name (whatever the case)
+    void near(const Location& latLng, int radius, std::vector<unsigned>& found) const;
+    void find(const std::string& text, std::vector<unsigned>& found) const;
+    // writes restauraunt r's name, address, location, crime cost, number of crimes and
+    // the date of the latest one as a line of an answer
+    void describe(std::ostream& out, unsigned r) const;
+    // writes how many restauraunts, crimes and links there are
+    void stats(std::ostream& out) const;
+
+    SnapshotSettings settings;
+    std::vector<Restauraunt*> restauraunts;
+    SpatialIndex<Restauraunt>* index;
+    Layers layers;
+    TypeDictionary types;
+    CostModel costs;
+    // NULL until readTypesAndCosts
+    CrimeIngest* crimes;
+    // which snapshot this is, counting from 1 for the first one built
+    unsigned long long generation;
+
+private:
+    Snapshot(const Snapshot&);
+    Snapshot& operator=(const Snapshot&);
+
+    // the restauraunts all live here, and are all freed with it
+    Arena<Restauraunt> arena;
+};
+
+#endif
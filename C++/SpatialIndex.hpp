@@ -0,0 +1,52 @@
+/******************************************************************************
+ * SpatialIndex.hpp                                                           *
+ *                                                                            *
+ * What the crime pass needs from a spatial index: somewhere to put objects   *
+ * at locations, and a way of finding every object within a radius of a      *
+ * location. The QuadTree, KdTree and friends all implement this, so which    *
+ * one is used can be chosen when the program is run.                         *
+ *                                                                            *
+ * Queries can also be made a QueryBatch at a time. Indexes that can answer a *
+ * whole batch in one go (like the KdTree) do, and the rest fall back on      *
+ * answering the batch's queries one by one, in its Morton order.             *
+ ******************************************************************************/
+
+#ifndef SPATIAL_INDEX
+#define SPATIAL_INDEX
+
+#include <vector>
+
+#include "Location.h"
+#include "QueryBatch.hpp"
+
+template<class T>
+class SpatialIndex{
+public:
+    virtual ~SpatialIndex() {}
+
+    // adds an object at a location
+    virtual void insert(Location l, T* data) = 0;
+
+    // called once everything has been inserted, before any queries; indexes that are
+    // bulk loaded do all their work here
+    virtual void build() {}
+
+    // appends every object strictly within radius of the location l to v
+    virtual void findNodes(const Location& l, int radius, std::vector<T*>& v) = 0;
+
+    // finds every object strictly within radius of each of the n locations
+    // (xs[i], ys[i]), putting the answers in batch
+    virtual void findNodesBatch(const double* xs, const double* ys, size_t n, int radius,
+                                QueryBatch<T>& batch){
+        batch.reset(xs, ys, n);
+        for(unsigned q : batch.order){
+            batch.scratch.clear();
+            findNodes(Location(xs[q], ys[q]), radius, batch.scratch);
+            for(T* object : batch.scratch)
+                batch.add(q, object);
+        }
+        batch.finish();
+    }
+};
+
+#endif
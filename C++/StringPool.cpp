@@ -0,0 +1,141 @@
+/******************************************************************************
+ * StringPool.cpp                                                             *
+ *                                                                            *
+ * A pool of interned strings, each stored once and known by a small number. *
+ ******************************************************************************/
+
+#include "StringPool.h"
+
+using namespace std;
+
+// the hash table starts out with this many slots
+#define STRING_POOL_MIN_SLOTS 256
+
+StringPool::StringPool() : count(0){
+    building = top = limit = NULL;
+    chunkBytes = 0;
+    for(int i=0;i<STRING_POOL_BLOCKS;i++)
+        blocks[i] = NULL;
+    slots.assign(STRING_POOL_MIN_SLOTS, 0);
+}
+
+StringPool::~StringPool(){
+    for(char* chunk : chunks)
+        delete[] chunk;
+    for(int i=0;i<STRING_POOL_BLOCKS;i++)
+        delete[] blocks[i];
+}
+
+// FNV-1a
+unsigned long long StringPool::hash(const char* begin, const char* end){
+    unsigned long long h = 14695981039346656037ULL;
+    for(const char* p=begin;p<end;p++){
+        h ^= (unsigned char)*p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Strings being built sit at the top of the last chunk until they are finished, so
+// interning one is just a matter of starting one and finishing it straight away
+unsigned StringPool::intern(const char* begin, const char* end){
+    start();
+    append(begin, end);
+    return finish();
+}
+
+void StringPool::start(){
+    building = top;
+}
+
+void StringPool::append(const char* begin, const char* end){
+    reserve(end - begin);
+    memcpy(top, begin, end - begin);
+    top += end - begin;
+}
+
+// The rest of a chunk that a string doesn't fit in is just left empty
+void StringPool::reserve(size_t n){
+    // (and there always has to be room for the '\0')
+    if(top && top + n + 1 <= limit)
+        return;
+    size_t sofar = top - building;
+    size_t size = STRING_POOL_CHUNK;
+    while(size < sofar + n + 1)
+        size *= 2;
+    char* chunk = new char[size];
+    if(sofar)
+        memcpy(chunk, building, sofar);
+    chunks.push_back(chunk);
+    chunkBytes += size;
+    building = chunk;
+    top = chunk + sofar;
+    limit = chunk + size;
+}
+
+// Looks the string just built up in the table. If it is already in the pool the new
+// copy is thrown away again; otherwise it is kept, '\0' terminated, as the newest string
+unsigned StringPool::finish(){
+    reserve(0);
+    size_t length = top - building;
+    size_t mask = slots.size() - 1;
+    size_t slot = (size_t)hash(building, top) & mask;
+    for(;slots[slot] != 0;slot=(slot + 1) & mask){
+        unsigned id = slots[slot] - 1;
+        if(this->length(id) == length && memcmp(str(id), building, length) == 0){
+            top = building;
+            return id;
+        }
+    }
+    unsigned id = (unsigned)count;
+    *top++ = '\0';
+    size_t block = blockOf(id);
+    if(!blocks[block])
+        blocks[block] = new Place[(size_t)STRING_POOL_FIRST_BLOCK << block];
+    Place& p = blocks[block][id - STRING_POOL_FIRST_BLOCK*((1u << block) - 1)];
+    p.begin = building;
+    p.length = length;
+    slots[slot] = id + 1;
+    // the string is only counted once it is all there, for anyone reading size()
+    count = id + 1;
+    building = top;
+    // kept at most half full
+    if(size()*2 > slots.size())
+        grow();
+    return id;
+}
+
+bool StringPool::find(const char* begin, const char* end, unsigned& id) const{
+    size_t length = end - begin;
+    size_t mask = slots.size() - 1;
+    for(size_t slot=(size_t)hash(begin, end) & mask;slots[slot] != 0;slot=(slot + 1) & mask){
+        unsigned candidate = slots[slot] - 1;
+        if(this->length(candidate) == length && memcmp(str(candidate), begin, length) == 0){
+            id = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void StringPool::grow(){
+    vector<unsigned> old(slots.size()*2, 0);
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for(unsigned entry : old){
+        if(entry == 0)
+            continue;
+        const char* s = str(entry - 1);
+        size_t slot = (size_t)hash(s, s + length(entry - 1)) & mask;
+        while(slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = entry;
+    }
+}
+
+size_t StringPool::bytes() const{
+    size_t places = 0;
+    for(int i=0;i<STRING_POOL_BLOCKS && blocks[i];i++)
+        places += ((size_t)STRING_POOL_FIRST_BLOCK << i)*sizeof(Place);
+    return chunkBytes + places + slots.size()*sizeof(unsigned);
+}
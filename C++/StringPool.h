@@ -0,0 +1,113 @@
+/******************************************************************************
+ * StringPool.h                                                               *
+ *                                                                            *
+ * A pool of interned strings: each distinct string is stored exactly once,   *
+ * and known by a small number from then on. The restauraunts' descriptions   *
+ * only come in a handful of kinds ("Eating & Drinking" and so on), and chain *
+ * names and shared addresses repeat constantly, so a restauraunt holding     *
+ * three numbers into a pool takes a lot less room than three std::strings.   *
+ *                                                                            *
+ * The strings are kept end to end (each followed by a '\0') in chunks, and   *
+ * found again through an open addressing hash table. Strings are looked up   *
+ * straight from the characters of a Field, or built up a piece at a time in  *
+ * the pool itself, so interning a string that is already there never         *
+ * allocates anything.                                                        *
+ *                                                                            *
+ * Nothing in the pool ever moves once it has been added: a full chunk is     *
+ * left where it is and a new one started, and each string's place is kept in *
+ * blocks that double in size rather than in one vector that is reallocated.  *
+ * That way a snapshot that is being served (see Snapshot.h) can keep reading *
+ * its restauraunts' strings, without a lock, while the next snapshot is      *
+ * interning more (only ever one thread adds to a pool at a time, though).    *
+ ******************************************************************************/
+
+#ifndef STRING_POOL
+#define STRING_POOL
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Field.h"
+
+// the strings are kept in chunks of (at least) this many bytes
+#define STRING_POOL_CHUNK (1 << 16)
+
+// the first block of places holds this many strings, and each one after twice as many
+// as the last
+#define STRING_POOL_FIRST_BLOCK 256
+#define STRING_POOL_BLOCKS 32
+
+class StringPool{
+public:
+    StringPool();
+   ~StringPool();
+
+    // returns the number of the string [begin, end), adding it if it is new
+    unsigned intern(const char* begin, const char* end);
+    unsigned intern(const Field& f) { return intern(f.begin, f.end); }
+    unsigned intern(const char* s) { return intern(s, s + strlen(s)); }
+
+    // sets id to the number of the string [begin, end), returning false (and adding
+    // nothing) if it isn't in the pool
+    bool find(const char* begin, const char* end, unsigned& id) const;
+    bool find(const char* s, unsigned& id) const { return find(s, s + strlen(s), id); }
+
+    // Builds a string out of pieces, right in the pool: start(), then any number of
+    // append()s, then finish() to intern the whole thing and get its number
+    void start();
+    void append(const char* begin, const char* end);
+    void append(const Field& f) { append(f.begin, f.end); }
+    void append(const char* s) { append(s, s + strlen(s)); }
+    unsigned finish();
+
+    // the string numbered id ('\0' terminated), and its length
+    const char* str(unsigned id) const { return place(id).begin; }
+    size_t length(unsigned id) const { return place(id).length; }
+    std::string string(unsigned id) const { return std::string(str(id), length(id)); }
+
+    // how many distinct strings there are, and how many bytes they take up
+    size_t size() const { return count; }
+    size_t bytes() const;
+
+private:
+    StringPool(const StringPool&);
+    StringPool& operator=(const StringPool&);
+
+    // where a string is, and how long it is (not counting its '\0')
+    struct Place{
+        const char* begin;
+        size_t length;
+    };
+
+    // Block k holds the places of strings FIRST*(2^k - 1) up to FIRST*(2^(k+1) - 1)
+    static size_t blockOf(unsigned id) {
+        return 31 - __builtin_clz(id/STRING_POOL_FIRST_BLOCK + 1);
+    }
+    const Place& place(unsigned id) const {
+        size_t block = blockOf(id);
+        return blocks[block][id - STRING_POOL_FIRST_BLOCK*((1u << block) - 1)];
+    }
+
+    static unsigned long long hash(const char* begin, const char* end);
+    // makes room for n more bytes of the string being built, moving it to a new chunk
+    // if it doesn't fit in this one
+    void reserve(size_t n);
+    void grow();
+
+    // every chunk, the string being built (from building up to top) and the end of the
+    // chunk it is in
+    std::vector<char*> chunks;
+    char* building;
+    char* top;
+    char* limit;
+    size_t chunkBytes;
+    Place* blocks[STRING_POOL_BLOCKS];
+    std::atomic<size_t> count;
+    // the hash table: the number of the string in each slot plus one, or 0 if empty
+    std::vector<unsigned> slots;
+};
+
+#endif
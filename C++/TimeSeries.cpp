@@ -0,0 +1,87 @@
+/******************************************************************************
+ * TimeSeries.cpp                                                             *
+ *                                                                            *
+ * The crimes around each restauraunt, counted and costed by when they        *
+ * happened.                                                                  *
+ ******************************************************************************/
+
+#include "TimeSeries.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+TimeSeries::TimeSeries(){
+    period = SERIES_MONTH;
+    firstPeriod = 0;
+    periods = 0;
+}
+
+bool TimeSeries::parse(const char* name){
+    if(strcmp(name, "month") == 0)
+        period = SERIES_MONTH;
+    else if(strcmp(name, "week") == 0)
+        period = SERIES_WEEK;
+    else
+        return false;
+    return true;
+}
+
+// Months are numbered year*12 + month - 1, and weeks (which start on a Monday) by how
+// many Mondays there have been since the first one, rounding down for days before it
+int TimeSeries::periodOf(int day) const{
+    if(period == SERIES_WEEK){
+        int since = day - FIRST_MONDAY;
+        return since >= 0 ? since/7 : -((6 - since)/7);
+    }
+    int month, dayOfMonth, year;
+    Date::fromEpochDay(day).civil(month, dayOfMonth, year);
+    return year*12 + month - 1;
+}
+
+Date TimeSeries::startOf(int p) const{
+    if(period == SERIES_WEEK)
+        return Date::fromEpochDay(p*7 + FIRST_MONDAY);
+    return Date(p%12 + 1, 1, p/12);
+}
+
+void TimeSeries::reset(size_t n, int firstDay, int lastDay){
+    firstPeriod = periodOf(firstDay);
+    int last = periodOf(lastDay);
+    periods = last >= firstPeriod ? last - firstPeriod + 1 : 1;
+    counts.assign(n*(periods + 1), 0);
+    costs.assign(n*(periods + 1), 0);
+}
+
+void TimeSeries::accumulate(size_t r){
+    for(size_t at=row(r) + 1;at<=row(r) + periods;at++){
+        counts[at] += counts[at - 1];
+        costs[at] += costs[at - 1];
+    }
+}
+
+// The header names each period by its start, like "Crimes to 2015-04" for the running
+// count to the end of April 2015, or "Crimes to 2015-04-06" for the week starting then
+void TimeSeries::write(ostream& out, const vector<Restauraunt*>& restauraunts) const{
+    out << "Name, Address";
+    for(size_t i=0;i<periods;i++){
+        int month, day, year;
+        startOf(firstPeriod + (int)i).civil(month, day, year);
+        char name[16];
+        if(period == SERIES_WEEK)
+            snprintf(name, sizeof(name), "%04d-%02d-%02d", year, month, day);
+        else
+            snprintf(name, sizeof(name), "%04d-%02d", year, month);
+        out << ", Crimes to " << name << ", Cost to " << name;
+    }
+    out << '\n';
+    for(Restauraunt* r : restauraunts){
+        r->writeKey(out);
+        for(size_t i=1;i<=periods;i++){
+            size_t at = row(r->id) + i;
+            out << ", " << counts[at] << ", " << (double)costs[at]/SERIES_COST_SCALE;
+        }
+        out << '\n';
+    }
+}
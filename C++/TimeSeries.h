@@ -0,0 +1,119 @@
+/******************************************************************************
+ * TimeSeries.h                                                               *
+ *                                                                            *
+ * The crime cost squashes the whole history of the crimes around a           *
+ * restauraunt into one number, weighed by how long before today each was,    *
+ * and the only way to see anything over time from Food.csv is to go through  *
+ * its list of crimes again. A time series keeps the history instead: the     *
+ * crimes around each restauraunt are counted and costed by the month (or     *
+ * week) they happened in, from the month of the first dated crime around   *
+ * any restauraunt up to this one.                                            *
+ *                                                                            *
+ * Each restauraunt's totals are kept as running totals (prefix sums), so the *
+ * crimes between any two dates are just the difference of two of them, and   *
+ * asking for the cost of a restauraunt over a range, or the trend of the     *
+ * last few months, takes the same time however long the range. Series.csv    *
+ * has the running totals as they are, so the site can do the same.           *
+ *                                                                            *
+ * Crimes are costed at their initial cost (see CostModel), not decayed: the  *
+ * decay is all about how long ago a crime was, which the series already      *
+ * says. As with Rings, costs are added up in thousandths, as whole numbers.  *
+ ******************************************************************************/
+
+#ifndef TIME_SERIES
+#define TIME_SERIES
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <vector>
+
+#include "Date.h"
+#include "Restauraunt.h"
+
+// costs are added up in units of 1/SERIES_COST_SCALE
+#define SERIES_COST_SCALE 1000
+
+// 1/5/1970, the first Monday after the epoch, which weeks are counted from
+#define FIRST_MONDAY 4
+
+enum SeriesPeriod { SERIES_MONTH, SERIES_WEEK };
+
+class TimeSeries{
+public:
+    TimeSeries();
+
+    // Reads the length of the periods, "month" or "week", returning false if it is
+    // neither
+    bool parse(const char* period);
+
+    // The period a day (a Date::epochDay()) falls in, numbered from the epoch, and the
+    // day it starts on
+    int periodOf(int day) const;
+    Date startOf(int period) const;
+
+    // makes room for the series of n restauraunts, from the period of firstDay to the
+    // period of lastDay, all 0
+    void reset(size_t n, int firstDay, int lastDay);
+    // how many periods each series has, and the first of them
+    size_t size() const { return periods; }
+    int first() const { return firstPeriod; }
+
+    // adds a crime costing cost to period of restauraunt r, returning false (and adding
+    // nothing) if the period isn't in the series
+    bool add(size_t r, int period, double cost) {
+        if(period < firstPeriod || period - firstPeriod >= (int)periods)
+            return false;
+        size_t at = row(r) + (period - firstPeriod) + 1;
+        counts[at]++;
+        costs[at] += llround(cost*SERIES_COST_SCALE);
+        return true;
+    }
+    // turns restauraunt r's totals, once every crime has been added, into running totals
+    void accumulate(size_t r);
+
+    // The number and cost of restauraunt r's crimes from the period of fromDay to the
+    // period of toDay (so whole periods, and only those in the series: 0 if none of them
+    // are)
+    unsigned count(size_t r, int fromDay, int toDay) const {
+        size_t from, to;
+        return span(fromDay, toDay, from, to) ? counts[row(r) + to] - counts[row(r) + from] : 0;
+    }
+    double cost(size_t r, int fromDay, int toDay) const {
+        size_t from, to;
+        if(!span(fromDay, toDay, from, to))
+            return 0;
+        return (double)(costs[row(r) + to] - costs[row(r) + from])/SERIES_COST_SCALE;
+    }
+
+    // writes a row for each restauraunt, with the running count and cost up to the end
+    // of each period
+    void write(std::ostream& out, const std::vector<Restauraunt*>& restauraunts) const;
+
+private:
+    // where restauraunt r's series starts, and which of its periods period is
+    size_t row(size_t r) const { return r*(periods + 1); }
+    // the periods of the series from the period of fromDay to the period of toDay, as
+    // [from, to), or false if they have none in common
+    bool span(int fromDay, int toDay, size_t& from, size_t& to) const {
+        if(fromDay == INVALID_DAY || toDay == INVALID_DAY)
+            return false;
+        int first = std::max(periodOf(fromDay), firstPeriod);
+        int last = std::min(periodOf(toDay), firstPeriod + (int)periods - 1);
+        if(first > last)
+            return false;
+        from = first - firstPeriod;
+        to = last - firstPeriod + 1;
+        return true;
+    }
+
+    SeriesPeriod period;
+    int firstPeriod;
+    size_t periods;
+    // the running totals of each restauraunt, [row(r) + i + 1] being the total up to the
+    // end of the series' ith period, and [row(r)] always 0
+    std::vector<unsigned> counts;
+    std::vector<long long> costs;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * TypeDictionary.cpp                                                         *
+ *                                                                            *
+ * The numbers given to the incident types, kept in a file between runs.      *
+ ******************************************************************************/
+
+#include "TypeDictionary.h"
+
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+TypeDictionary::TypeDictionary(){
+    loaded = 0;
+    full = false;
+    for(int i=0;i<MAX_INCIDENT_TYPES;i++)
+        excludedTypes[i] = false;
+}
+
+bool TypeDictionary::load(const char* path){
+    ifstream in(path);
+    if(!in)
+        return false;
+    string line;
+    while(getline(in, line)){
+        // in case the file was edited somewhere with \r\n line endings
+        if(!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        id(line.data(), line.data() + line.size());
+    }
+    loaded = names.size();
+    return true;
+}
+
+bool TypeDictionary::save(const char* path) const{
+    ofstream out(path);
+    for(size_t i=0;i<names.size();i++)
+        out << names.str(i) << '\n';
+    return (bool)out;
+}
+
+unsigned char TypeDictionary::id(const char* begin, const char* end){
+    unsigned type;
+    if(names.find(begin, end, type))
+        return (unsigned char)(type < MAX_INCIDENT_TYPES ? type : MAX_INCIDENT_TYPES - 1);
+    if(names.size() >= MAX_INCIDENT_TYPES){
+        if(!full)
+            cerr << "More than " << MAX_INCIDENT_TYPES << " incident types; the rest are "
+                 << "counted as " << names.str(MAX_INCIDENT_TYPES - 1) << endl;
+        full = true;
+        return MAX_INCIDENT_TYPES - 1;
+    }
+    type = names.intern(begin, end);
+    // A type excluded before it was ever seen
+    for(const string& name : excludedNames)
+        if(name.size() == names.length(type) && name == names.str(type))
+            excludedTypes[type] = true;
+    return (unsigned char)type;
+}
+
+bool TypeDictionary::find(const char* name, unsigned char& type) const{
+    unsigned found;
+    if(!names.find(name, found) || found >= MAX_INCIDENT_TYPES)
+        return false;
+    type = (unsigned char)found;
+    return true;
+}
+
+void TypeDictionary::exclude(const char* name){
+    excludedNames.push_back(name);
+    unsigned char type;
+    if(find(name, type))
+        excludedTypes[type] = true;
+}
@@ -0,0 +1,71 @@
+/******************************************************************************
+ * TypeDictionary.h                                                           *
+ *                                                                            *
+ * The numbers given to the incident types (INCIDENT_TYPE_DESCRIPTION), kept  *
+ * in a file between runs. Every type in the file keeps the number it was     *
+ * given the first time it was seen, whatever crime file is read later and   *
+ * in whatever order its types show up; new types are numbered after the rest *
+ * and added to the end of the file. So the types in Crime.csv mean the same  *
+ * thing from one data refresh to the next.                                   *
+ *                                                                            *
+ * The file is just one name per line, the line being the number (from 0).   *
+ *                                                                            *
+ * Some types are excluded from the scoring altogether (MedAssist, by         *
+ * default), and those are chosen by name when the program is run rather     *
+ * than by a number fixed at compile time, so they can be named before the    *
+ * type has ever been seen.                                                   *
+ *                                                                            *
+ * The names are kept in a StringPool, so looking a type up straight from the *
+ * Field it was read from never allocates anything.                           *
+ ******************************************************************************/
+
+#ifndef TYPE_DICTIONARY
+#define TYPE_DICTIONARY
+
+#include <string>
+#include <vector>
+
+#include "Field.h"
+#include "StringPool.h"
+
+// types are stored in an unsigned char, so there can be at most this many; any type
+// after that is lumped in with the last (there have only ever been about 30)
+#define MAX_INCIDENT_TYPES 256
+
+class TypeDictionary{
+public:
+    TypeDictionary();
+
+    // reads the types in the file at path, numbered in the order they are listed;
+    // returns false if there was no file (which is fine the first time round)
+    bool load(const char* path);
+    // writes every type out to path, in order, returning false if it couldn't
+    bool save(const char* path) const;
+
+    // returns the number of the type [begin, end), numbering it next if it is new
+    unsigned char id(const char* begin, const char* end);
+    unsigned char id(const Field& f) { return id(f.begin, f.end); }
+    unsigned char id(const char* s) { return id(s, s + strlen(s)); }
+    // sets type to the number of the type named name, returning false if it hasn't
+    // been seen
+    bool find(const char* name, unsigned char& type) const;
+
+    // Leaves the type named name out of the scoring, whether or not it has been seen yet
+    void exclude(const char* name);
+    bool excluded(unsigned char type) const { return excludedTypes[type]; }
+    const std::vector<std::string>& exclusions() const { return excludedNames; }
+
+    const char* name(unsigned char type) const { return names.str(type); }
+    size_t size() const { return names.size(); }
+    // true if types have been numbered since the file was loaded (and so it needs saving)
+    bool changed() const { return names.size() != loaded; }
+
+private:
+    StringPool names;
+    size_t loaded;
+    bool full;
+    std::vector<std::string> excludedNames;
+    bool excludedTypes[MAX_INCIDENT_TYPES];
+};
+
+#endif
@@ -7,7 +7,8 @@
  * data.cityofboston.gov: the active food establishment licenses database and the crime *
  * incident reports database. These files were downloaded and a python script run upon  *
  * them that filled out missing location data for the restauraunts by generating a      *
- * JSON file with keys of addresses and values of latitude/longitude location.          *
+ * geocode cache of the latitude/longitude location of each address, which is memory    *
+ * mapped and looked up as it is (see GeoCache.h).                                      *
  *                                                                                      *
  * The analysis done basically builds what I believe to be a QuadTree (I have never     *
  * previously encountered that data structure) to hold every restauraunt at a specific  *
@@ -27,298 +28,497 @@
  * use them with the Google Maps API                                                    *
  *                                                                                      *
  * Compile with                                                                         *
- *       g++ -g -std=c++11 -o analyze *.cpp                                             *
+ *       g++ -g -std=c++11 -o analyze *.cpp -lz -pthread                                *
  * Run with                                                                             *
- *      ./analyze                                                                       *
+ *      ./analyze [-t threads] [-p] [-i kd|grid|quad] [-b] [-d] [-x type]... [-c file]  *
+ *                [-s file] [-r radii] [-w meters] [-e period] [-l file] [-m file]      *
+ *                [-u] [-q]                                                             *
  *                                                                                      *
- * If using a different version of Crime_Incident_Reports.csv, remember that            *
- * for MedAssist reports not to be counted, it is necessary to update the Crime.h       *
- * definition of MED_ASSIST to be the value outputted at the very end.                  *
+ * The incident types are numbered in TYPE_FILE, which keeps each type's number the     *
+ * same from one version of Crime_Incident_Reports.csv to the next (new types are added *
+ * to the end). MedAssist reports are not counted, which -x changes: each -x NAME       *
+ * leaves out the type NAME instead, and -x '' leaves out nothing.                      *
+ *                                                                                      *
+ * What each crime costs (per weapon, shooting and type) and how quickly that falls off *
+ * with time are read from COST_FILE (or the file given with -c) on every run, so the   *
+ * weights can be changed without recompiling. And -s scores every restauraunt under    *
+ * each of the sets of costs in a sweep file (see CostSweep.h) at once, writing the     *
+ * scores to SWEEP_OUT, for comparing a lot of weights without a run for each.          *
+ *                                                                                      *
+ * Similarly, -r 50,100,250 counts and costs the crimes around each restauraunt in      *
+ * rings 0-50, 50-100 and 100-250 meters away (-w weighs them by distance too), in one  *
+ * more pass over the crimes, writing them to RINGS_OUT.                                *
+ * And -e month (or week) counts and costs them by the month (or week) they happened    *
+ * in, as running totals, so the crimes of any range of months are the difference of    *
+ * two columns of SERIES_OUT (see TimeSeries.h).                                        *
+ *                                                                                      *
+ * Other places (bars, schools, transit stops...) can be scored in the same pass as     *
+ * the restauraunts with -l, which reads a layer file naming their CSVs (see Layers.h)  *
+ * and writes each layer's scores to LAYER_OUT + the layer's name + ".csv".             *
+ *                                                                                      *
+ * Every run saves what it worked out to STATE_FILE, and with -u the next run carries   *
+ * on from there: only the rows added to the end of the crime file since are read, the  *
+ * restauraunts whose licences are new are linked to the crimes already read, and the   *
+ * closed ones dropped. Everything is still scored again, as the scores depend on how   *
+ * long ago each crime was.                                                             *
+ *                                                                                      *
+ * With -q, nothing is written: everything is built into a Snapshot, and queries (like  *
+ * "near 42.35 -71.06" or "find pizza") are answered from it, a line at a time, from    *
+ * stdin. "reload" builds a new snapshot from the files in the background, and the old  *
+ * one goes on answering until the new one is swapped in (see Snapshot.h).              *
+ * And -m FILE saves everything built to FILE in a form that is queried straight from   *
+ * a memory mapping (see MappedSnapshot.h), which -q -m FILE serves from instead of     *
+ * building anything, and reloads by mapping FILE again.                                *
+ *                                                                                      *
+ * Both input CSVs are memory mapped rather than streamed through an ifstream, and can  *
+ * also be given gzipped (just point FOOD_FILE or CRIME_FILE at the .csv.gz), in which  *
+ * case they are inflated on the fly.                                                   *
+ *                                                                                      *
+ * The QuadTree has since been replaced (by default) with a balanced, bulk loaded       *
+ * KdTree, which finds exactly the same restauraunts; -i quad brings the old one back,   *
+ * and -i grid uses a HashGrid made for the fixed CRIME_RADIUS. -b times all three.     *
  ****************************************************************************************/
 
 
 #include <vector>
 #include <iostream>
 #include <fstream>
-#include <unordered_map>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
 
 #include "Location.h"
 #include "Date.h"
 #include "Crime.h"
 #include "Restauraunt.h"
-#include "QuadTree.hpp"
+#include "Arena.hpp"
+#include "Indexes.h"
+#include "CsvReader.h"
+#include "CrimeIngest.h"
+#include "EpochPointer.hpp"
+#include "MappedSnapshot.h"
+#include "Snapshot.h"
 
 // These describe the locations of the CSV files downloaded from data.cityofboston.gov
 #define FOOD_FILE "../data/Active_Food_Establishment_Licenses.csv"
 #define CRIME_FILE "../data/Crime_Incident_Reports.csv"
 
-// locs.json was a file generated by a python script that went through all of the restauraunts
+// locs.bin is a file generated by a python script that went through all of the restauraunts
 // and if the location was not set, used Googles Geocoding API to determine the latitude and
-// longitude from the address
-#define LOC_FILE "../data/locs.json"
+// longitude from the address (see GeoCache.h)
+#define GEOCODE_FILE "../data/locs.bin"
 
 // These are the output files: relevent restauraunt info and crime info parsed from the 
 // city of Boston data
 #define FOOD_OUT "../data/Food.csv"
 #define CRIME_OUT "../data/Crime.csv"
 
-using namespace std;
+// The incident types, one per line, each numbered by the line it is on. It is created
+// the first time round, and any new types are added to the end of it
+#define TYPE_FILE "../data/IncidentTypes.txt"
 
-// Originally, I was wokring entirely in python, so as mentioned in the description for LOCS_FILE,
-// I just outputted a JSON file which I then converted to a dict in two lines. C++ made this a 
-// little more difficult, and what follows simply transforms the JSON of the LOC_FILE into
-// an unordered map for easy access, and returns a pointer to that map 
-unordered_map<string, Location>* parseLocFile(){
-    ifstream in(LOC_FILE);
-    unordered_map<string, Location>* map = new unordered_map<string, Location>();
-    in.get();
-    in.get();
-    char* key = new char[100];
-    char* num = new char[20];
-    int keyIndex = 0, numIndex = 0;
-    Location loc = {0,0};
-    char c ;
-    bool readingKey=true;
-    while(c = in.get()){
-        if(c == '}')
-            break;
-        if(readingKey){
-            if(c == '"'){
-                key[keyIndex] = '\0';
-                in.get(); // ':'
-                in.get(); // '['
-                in.get(); // ' '
-                readingKey = false;
-                keyIndex = 0;
-            }else{
-                key[keyIndex] = c;
-                keyIndex++;
-            }
-        }else{
-            if(c == ','){
-                num[numIndex] = '\0';
-                loc.x = stof(string(num));
-                numIndex = 0;
-                in.get(); // ' '
-            }else if(c == ']'){
-                num[numIndex] = '\0';
-                loc.y = stof(string(num));
-                map->emplace(string(key), loc);
-                keyIndex = 0;
-                numIndex = 0;
-                if(in.get() == '}'){
-                    break;
-                }
-                in.get(); // ','
-                in.get(); // '\n'
-                readingKey = true;
-            }else{
-                num[numIndex] = c;
-                numIndex++;
-            }
-        }
-    }
-    delete[] key;
-    delete[] num;
-    return map;
-}
+// What each crime costs, and how that falls off with time; see the file itself
+#define COST_FILE "../data/CrimeCosts.cfg"
 
-// Then, as all the restauraunts that lack a location are stored in an unordered map, this
-// function easily and quickly returns the location for a given restauraunt's address:
+// The score matrix written by a sweep (-s), a row per restauraunt and a column per set
+#define SWEEP_OUT "../data/Sweep.csv"
 
-Location& getLocationFromAddress(unordered_map<string, Location>* addresses, string address){
-    Location& l=(*addresses)[address];
-    return (*addresses)[address];
-}
+// The crimes around each restauraunt by distance, written with -r
+#define RINGS_OUT "../data/Rings.csv"
 
+// The crimes around each restauraunt by month or week, written with -e
+#define SERIES_OUT "../data/Series.csv"
 
+// Each layer given with -l is written to this followed by its name and ".csv"
+#define LAYER_OUT "../data/Layer_"
 
+// What the crime pass worked out, saved for the next run to carry on from with -u
+#define STATE_FILE "../data/State.bin"
 
-// This function maps over the QuadTree
-// This outputs an individual restauraunt
-void writeRestauraunt(Restauraunt* r, void* cl){
-    ofstream* out = (ofstream*)cl;
-    (*out) << (*r);
-}
+// While serving, a query answers with at most this many restauraunts
+#define SERVE_MAX_ANSWERS 50
 
-// This should work, but it seems results in a double 
-// free, so I guess not? I don't care too much about memory management
-// for this project, though.
-void deleteRestauraunt(Restauraunt* r, void* cl){
-    delete r;
-}
+// the incident type left out of the scoring unless -x says otherwise
+#define DEFAULT_EXCLUDED_TYPE "MedAssist"
+
+using namespace std;
 
+// Prints how to run the program
+void usage(const char* name){
+    cerr << "Usage: " << name << " [-t threads] [-p] [-i index] [-b] [-d] [-x type]... [-c file] [-s file]\n"
+         << "              [-r radii] [-w meters] [-e period] [-l file] [-m file] [-u] [-q]\n"
+         << "  -t, --threads N   split the crime pass over N threads (default: one per core)\n"
+         << "  -p, --pipeline    run the crime pass as a pipeline of reader, parser, join and\n"
+         << "                    writer threads, printing how busy each queue was\n"
+         << "  -i, --index NAME  the spatial index to find restauraunts with: kd (default),\n"
+         << "                    grid or quad\n"
+         << "  -b, --bench       just time each of the indexes on the crime file\n"
+         << "  -d, --delta       delta encode the links between restauraunts and crimes,\n"
+         << "                    to save memory\n"
+         << "  -x, --exclude NAME  leave crimes of the incident type NAME out of the scoring\n"
+         << "                    (can be given more than once; default: " DEFAULT_EXCLUDED_TYPE
+         << ")\n"
+         << "  -c, --costs FILE  read what crimes cost from FILE (default: " COST_FILE ")\n"
+         << "  -s, --sweep FILE  also score every restauraunt under each set of costs in\n"
+         << "                    FILE, writing the scores to " SWEEP_OUT "\n"
+         << "  -r, --rings LIST  also count and cost the crimes around every restauraunt in\n"
+         << "                    rings of these radii (in meters, like 50,100,250), writing\n"
+         << "                    them to " RINGS_OUT "\n"
+         << "  -w, --weigh M     weigh the cost of each crime in the rings by its distance,\n"
+         << "                    halving every M meters\n"
+         << "  -e, --series PERIOD  also count and cost the crimes around every restauraunt\n"
+         << "                    by the month or week (PERIOD) they happened in, writing the\n"
+         << "                    running totals to " SERIES_OUT "\n"
+         << "  -l, --layers FILE also score the places of every layer in FILE (see Layers.h),\n"
+         << "                    writing each layer to " LAYER_OUT "NAME.csv\n"
+         << "  -m, --map FILE    also save everything built to FILE, in a form that can be\n"
+         << "                    memory mapped and queried as it is (see MappedSnapshot.h);\n"
+         << "                    with -q, answer queries from FILE instead of building\n"
+         << "  -u, --update      only read the crimes added to the crime file since the last\n"
+         << "                    run, and the licences opened or closed since\n"
+         << "  -q, --serve       build everything (or map it, with -m), then answer queries\n"
+         << "                    from stdin (and reload when asked) instead of writing the CSVs\n";
+}
 
-int main(){
-    
-    unordered_map<string, Location>* addresses = parseLocFile();
+// Prints restauraunts as the answer to a query, one per line, then a blank line
+template<class S>
+static void answer(const vector<unsigned>& found, const S& snapshot){
+    for(size_t i=0;i<found.size() && i<SERVE_MAX_ANSWERS;i++)
+        snapshot.describe(cout, found[i]);
+    if(found.size() > SERVE_MAX_ANSWERS)
+        cout << "(and " << found.size() - SERVE_MAX_ANSWERS << " more)\n";
+    cout << endl;
+}
 
-    // builds the QuadTree! and reads in all of the restauraunts.
-    // I constructed the restauraunt class so as to simply use the >> operator
-    // to read a line from the CSV file
-    Restauraunt* r = new Restauraunt;
-    ifstream foodFile(FOOD_FILE);
-    foodFile.ignore(1000, '\n'); // Ignore first line
-    QuadTree<Restauraunt> quad;
-    while(!(foodFile >> (*r)).eof()){
-        // If the location wasn't set, use the address to find the location
-        if(!r->locationSet()){
-            r->setLocation(getLocationFromAddress(addresses, r->address));
+// Answers queries, a line at a time, from stdin:
+//     near LAT LNG [METERS]  the restauraunts within METERS (CRIME_RADIUS by default,
+//                            and at most MAX_RADIUS), nearest first
+//     find TEXT              the restauraunts with TEXT in their name
+//     stats                  what the snapshot being served holds
+//     reload                 loads a new snapshot in the background, which is swapped
+//                            in once it is ready
+//     quit
+// Each restauraunt is answered with its name, address, location, crime cost, number
+// of crimes and the date of the latest. Everything about loading snapshots is printed
+// to cerr, so that cout only ever has answers on it. The queries are all answered from
+// whichever snapshot is current when they come in (see Snapshot.h), so they carry on
+// while a reload runs.
+// The snapshots are either Snapshots, built from the files, or MappedSnapshots mapped
+// from a file written by an earlier run; load() makes one (or returns NULL)
+template<class S, class Load>
+static int serve(Load load){
+    // stdin is the only reader
+    EpochPointer<S> current(1, load());
+    {
+        typename EpochPointer<S>::Guard snapshot(current, 0);
+        if(!snapshot.get())
+            return 1;
+        cerr << "Serving ";
+        snapshot->stats(cerr);
+        cerr << endl;
+    }
+    atomic<bool> reloading(false);
+    thread reloader;
+    string line;
+    while(getline(cin, line)){
+        istringstream words(line);
+        string command;
+        if(!(words >> command))
+            continue;
+        if(command == "quit")
+            break;
+        if(command == "reload"){
+            // (only one at a time)
+            if(reloading.exchange(true)){
+                cout << "Already reloading\n" << endl;
+                continue;
+            }
+            if(reloader.joinable())
+                reloader.join();
+            unsigned long long generation = current.generation() + 2;
+            reloader = thread([&current, &reloading, load, generation](){
+                S* next = load();
+                if(next){
+                    next->generation = generation;
+                    current.publish(next);
+                    cerr << "Now serving snapshot " << generation << " (";
+                    next->stats(cerr);
+                    cerr << ")" << endl;
+                }else{
+                    cerr << "Reloading failed, so still serving the old snapshot\n";
+                }
+                reloading = false;
+            });
+            cout << "Reloading\n" << endl;
+            continue;
+        }
+        typename EpochPointer<S>::Guard snapshot(current, 0);
+        vector<unsigned> found;
+        if(command == "near"){
+            Location l;
+            int radius = CRIME_RADIUS;
+            string meters;
+            bool ok = (bool)(words >> l.x >> l.y);
+            // the radius, if given, has to be a whole number of meters, up to MAX_RADIUS
+            if(ok && words >> meters){
+                char* end;
+                long given = strtol(meters.c_str(), &end, 10);
+                ok = *end == '\0' && given > 0 && given <= MAX_RADIUS;
+                radius = (int)given;
+            }
+            if(!ok){
+                cout << "Usage: near LAT LNG [METERS], with METERS from 1 to " << MAX_RADIUS
+                     << "\n" << endl;
+                continue;
+            }
+            snapshot->near(l, radius, found);
+            answer(found, *snapshot);
+        }else if(command == "find"){
+            string text;
+            getline(words >> ws, text);
+            snapshot->find(text, found);
+            answer(found, *snapshot);
+        }else if(command == "stats"){
+            cout << "Snapshot " << snapshot->generation << ": ";
+            snapshot->stats(cout);
+            cout << (reloading ? ", reloading" : "") << '\n' << endl;
+        }else{
+            cout << "Unknown command " << command << "; try near, find, stats, reload or quit\n"
+                 << endl;
         }
-        // Which means that now the metric location of the restauraunt is known, 
-        // and can be inserted into the QuadTree
-        quad.insert(r->metricLocation, r);
-        r = new Restauraunt;
     }
-    delete r;
-    foodFile.close();
-    
-    /* Data is stored in crime csv as:
-     * COMPNOS,NatureCode,INCIDENT_TYPE_DESCRIPTION,MAIN_CRIMECODE,REPTDISTRICT,
-     * REPORTINGAREA,FROMDATE,WEAPONTYPE,Shooting,DOMESTIC,
-     * SHIFT,Year,Month,DAY_WEEK,UCRPART,
-     * X,Y,STREETNAME,XSTREETNAME,Location
-     * 
-     * We want INCIDENT_TYPE_DESCRIPTION [2], FROMDATE [6], WEAPONTYPE [7], Shooting [8], and Location [19]
-     */
-    
-    ifstream crimeFile(CRIME_FILE);
-    ofstream crimeOut (CRIME_OUT);
-    // Output the crime header
-    crimeOut << "Location, Date, Type, Danger\n";
-    crimeFile.ignore(1000, '\n'); // Ignore first line
-    
-    char buff[128];
-    
-    // There were only like 30 destinct incident types, not all of which I understood, so I just assigned
-    // each a numerical value. This unordered_map is how: if an incident was not in incidentTypes, set
-    // the value to the incidentCount and store that in incidentTypes, and increment incidentCount
-    unordered_map<string, unsigned char> incidentTypes;
-    unsigned char incidentCount = 0;
-    string incidentType;
-    
-    unordered_map<string, unsigned char>::const_iterator iter;
-    // m stores metric location, l stores latitude/longitude
-    Location m,l;
-    
-    int i=0;
-    
-    // I realized after a bit that I would want a date representing now to determine how long ago things
-    // happened, but I didn't want too create a new date for every restauraunt or crime, so last minute
-    // I added this variable
-    Date now = Date::now();
-    vector<struct Crime*> crimes;
+    if(reloader.joinable())
+        reloader.join();
+    return 0;
+}
+
+int main(int argc, char** argv){
     
-    // I decided for the crimes, ad I wanted to keep tack of incident types
-    // and the like, that rather than doing stream operators I would just do it all
-    // here. It doesn't make or the cleanes code, b
-    while(!crimeFile.eof()){
-        struct Crime* c = new struct Crime;
-        c->copies = 0;
-        // This loops through the 20 cells of information in the CSV and extracts
-        // the relevent bits
-        for(int i=0;i<19;i++){
-            crimeFile.getline(buff, 128, ',');
-            
-            if(crimeFile.eof())
-                break;
-            switch(i){
-                case 2:// INCIDENT_TYPE_DESCRIPTION
-                    ;
-                    incidentType = string(buff); 
-                    iter = incidentTypes.find(incidentType);
-                    if(iter == incidentTypes.end()){
-                        // Then the incidentType isn't in incidentTypes
-                        incidentTypes.emplace(incidentType, incidentCount);
-                        c->type = incidentCount;
-                        incidentCount++;
-                    }else{
-                        c->type = iter->second;
-                    }
-                    break;
-                case 6: // FROMDATE
-                    c->date.setDate(buff);
-                    break;
-                case 7: // WEAPONTYPE (either Unarmed, Other, Knife, or Firearm)
-                    switch(buff[0]){
-                        case 'U': // Unarmed
-                            c->weapon = 0;
-                            break;
-                        case 'O': // Other
-                            c->weapon = 1;
-                            break;
-                        case 'K': // Knife
-                            c->weapon = 2;
-                            break;
-                        case 'F': // Firearm
-                            c->weapon = 3;
-                            break;
-                        default:
-                            break;
-                    }
-                    break;
-                case 8: //Shooting (Yes or No)
-                    
-                    // If there was a shooting, add a shooting flag
-                    if(buff[0] == 'Y'){ 
-                        c->weapon += 4;
-                    }
-                    break;
-                default:
-                    break;
+    int threads = thread::hardware_concurrency();
+    bool pipeline = false;
+    string indexName = "kd";
+    bool bench = false;
+    bool delta = false;
+    vector<string> excluded;
+    bool excludeGiven = false;
+    const char* costFile = COST_FILE;
+    const char* sweepFile = NULL;
+    Rings rings;
+    bool ringsGiven = false;
+    TimeSeries series;
+    bool seriesGiven = false;
+    bool update = false;
+    const char* layerFile = NULL;
+    const char* mapFile = NULL;
+    bool serving = false;
+    for(int i=1;i<argc;i++){
+        string arg(argv[i]);
+        if((arg == "-t" || arg == "--threads") && i+1 < argc){
+            threads = atoi(argv[++i]);
+        }else if(arg == "-p" || arg == "--pipeline"){
+            pipeline = true;
+        }else if((arg == "-i" || arg == "--index") && i+1 < argc){
+            indexName = argv[++i];
+        }else if(arg == "-b" || arg == "--bench"){
+            bench = true;
+        }else if(arg == "-d" || arg == "--delta"){
+            delta = true;
+        }else if((arg == "-x" || arg == "--exclude") && i+1 < argc){
+            excludeGiven = true;
+            if(argv[++i][0] != '\0')
+                excluded.push_back(argv[i]);
+        }else if((arg == "-c" || arg == "--costs") && i+1 < argc){
+            costFile = argv[++i];
+        }else if((arg == "-s" || arg == "--sweep") && i+1 < argc){
+            sweepFile = argv[++i];
+        }else if((arg == "-r" || arg == "--rings") && i+1 < argc){
+            ringsGiven = true;
+            if(!rings.parse(argv[++i])){
+                usage(argv[0]);
+                return 1;
             }
-        }   
-        crimeFile.getline(buff, 128); //This is the location
-        l.setLocation(buff);
-        m.setLocation((l.x - MIN_LAT)*LAT_TO_METERS , 
-                      (l.y - MIN_LNG)*LNG_TO_METERS);
-        // Output the crime CSV
-        crimeOut << '"' << l << "\", " << c->date << ", "
-                 << int(c->type) << ", " << int(c->weapon) << endl;
-        
-        // the call to quad.findNodes(m, 100) finds all nodes in the QuadTree within
-        // a distance of 100 from the location m, which is the metric coordinates of the crime
-        vector<Restauraunt*> v = quad.findNodes(m, 100);
-        
-        // This bit iterates through and adds the crime to the objects of nearby restauraunts
-        if(!v.empty()){
-            int initialCost = initialCrimeCost(*c);
-            // If the initial cost is 0, no need to add the crime, as that means it was ignorable?
-            // Basically I just decided that a MedAssist incident probably shouldn't be counted,
-            // although I don't actually kknow what that means, its frequency and name suggests
-            // that perhaps the police were merely assisting with something of a medical nature.
-            
-            if(initialCost > 0){
-                for(Restauraunt* r: v){
-                    r->addCrime(c, m, initialCost, now);
-                }
+        }else if((arg == "-w" || arg == "--weigh") && i+1 < argc){
+            rings.setDistanceDecay(atof(argv[++i]));
+        }else if((arg == "-e" || arg == "--series") && i+1 < argc){
+            seriesGiven = true;
+            if(!series.parse(argv[++i])){
+                usage(argv[0]);
+                return 1;
             }
+        }else if((arg == "-l" || arg == "--layers") && i+1 < argc){
+            layerFile = argv[++i];
+        }else if((arg == "-m" || arg == "--map") && i+1 < argc){
+            mapFile = argv[++i];
+        }else if(arg == "-u" || arg == "--update"){
+            update = true;
+        }else if(arg == "-q" || arg == "--serve"){
+            serving = true;
+        }else{
+            usage(argv[0]);
+            return 1;
         }
-        // if c->copies = 0, then it wasn't within 100 meters of any restauraunt and should be deleted
-        if(c->copies = 0)
-            delete c;
+    }
+    if(!excludeGiven)
+        excluded.push_back(DEFAULT_EXCLUDED_TYPE);
+    SnapshotSettings settings;
+    settings.foodFile = FOOD_FILE;
+    settings.crimeFile = CRIME_FILE;
+    settings.geocodeFile = GEOCODE_FILE;
+    settings.typeFile = TYPE_FILE;
+    settings.costFile = costFile;
+    settings.layerFile = layerFile ? layerFile : "";
+    settings.indexName = indexName;
+    settings.excluded = excluded;
+    settings.threads = threads;
+    settings.pipeline = pipeline;
+    if(serving && mapFile){
+        string path = mapFile;
+        return serve<MappedSnapshot>([path](){
+            MappedSnapshot* snapshot = new MappedSnapshot;
+            if(!snapshot->open(path.c_str())){
+                delete snapshot;
+                return (MappedSnapshot*)NULL;
+            }
+            return snapshot;
+        });
+    }
+    if(serving)
+        return serve<Snapshot>([settings](){ return Snapshot::build(settings, cerr); });
+
+    // Everything is built in a Snapshot (see Snapshot.h), a step at a time so that the
+    // benchmark and -u can get in between the steps
+    Snapshot snapshot(settings);
+    if(!snapshot.index){
+        usage(argv[0]);
+        return 1;
+    }
+    snapshot.readRestauraunts(cout);
+    vector<Restauraunt*>& restauraunts = snapshot.restauraunts;
+    cout << restauraunts.size() << " restauraunts, with " << Restauraunt::strings.size()
+         << " distinct names, addresses and descriptions in "
+         << Restauraunt::strings.bytes() << " bytes\n";
+    if(bench){
+        benchmarkIndexes(restauraunts, CRIME_FILE, cout);
+        return 0;
+    }
+    snapshot.index->build();
+    if(!snapshot.readLayers(cout)){
+        cerr << "Could not read " << layerFile << endl;
+        return 1;
+    }
+    
+    // Then the crimes: each is read, written to the (much smaller) crime CSV, and added to
+    // all of the restauraunts within CRIME_RADIUS of it. See CrimeIngest.h for how
+    snapshot.readTypesAndCosts(cout);
+    TypeDictionary& types = snapshot.types;
+    // and every set the analysts want to compare, each starting from the costs
+    CostSweep sweep;
+    if(sweepFile && !sweep.load(sweepFile, snapshot.costs)){
+        cerr << "Could not read " << sweepFile << endl;
+        return 1;
+    }
+    CrimeIngest& crimes = *snapshot.crimes;
+    // With -u, everything read last time is picked up from the saved state, so that only
+    // the rows added to the crime file since need reading
+    bool resumed = false;
+    if(update){
+        CrimeState state;
+        if(!state.load(STATE_FILE))
+            cout << "Nothing saved in " << STATE_FILE << ", so reading every crime\n";
+        else if(!CrimeState::reaches(CRIME_FILE, state.watermark))
+            cout << "The crime file is shorter than it was last time, so reading every crime\n";
+        else if(state.fingerprint != CrimeState::fingerprintOf(CRIME_FILE, state.watermark))
+            cout << "The crime file isn't the one read last time, so reading every crime\n";
+        else{
+            crimes.resume(state);
+            resumed = true;
+        }
+    }
+    if(!(pipeline ? crimes.runPipeline(CRIME_FILE, cout)
+                  : crimes.run(CRIME_FILE)))
+        return 1;
+    // Crime.csv just has the new crimes added to the end of it, unless one of the crimes
+    // already in it has changed (or it has gone)
+    if(resumed && !crimes.resumedChanged && ifstream(CRIME_OUT)){
+        ofstream crimeOut (CRIME_OUT, ios::app);
+        crimes.writeCrimes(crimeOut, crimes.resumedCrimes);
+    }else{
+        ofstream crimeOut (CRIME_OUT);
+        // Output the crime header
+        crimeOut << "Location, Date, Type, Danger\n";
+        crimes.writeCrimes(crimeOut, 0);
+    }
+    if(delta)
+        crimes.links.compress();
+    cout << crimes.links.links() << " links between restauraunts and crimes, in "
+         << crimes.links.bytes() << " bytes\n";
+    crimes.score();
+    cout << types.size() << " incident types";
+    if(types.changed()){
+        if(types.save(TYPE_FILE))
+            cout << ", now saved to " << TYPE_FILE;
         else
-            crimes.push_back(c);
-        i++;
-        if(i%100 == 0)
-            cout << i << " crimes processed\n";
+            cerr << "Could not save the incident types to " << TYPE_FILE << endl;
     }
-    crimeFile.close();
-    crimeOut.close();
-    cout << "MedAssist: " << (int)incidentTypes["MedAssist"] << endl;
-    // This section outputs the food CSV nice and succinctly
+    cout << endl;
+    for(const string& name : types.exclusions()){
+        unsigned char type;
+        if(types.find(name.c_str(), type))
+            cout << "Excluded " << name << " (" << (int)type << ")\n";
+        else
+            cout << "Excluded " << name << ", which never showed up\n";
+    }
+    // The sweep only needs the links already built, so it is one more (if wider) pass
+    // over them rather than a run per set
+    if(sweep.size() > 0){
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        sweep.update(types);
+        vector<double> scores;
+        crimes.sweep(sweep, scores);
+        cout << "Scored " << sweep.size() << " sets of costs in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+             << " ms\n";
+        ofstream sweepOut (SWEEP_OUT);
+        sweep.write(sweepOut, restauraunts, scores);
+    }
+    // The rings look every crime up again, once, at the largest radius
+    if(ringsGiven){
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        crimes.scoreRings(rings);
+        cout << "Sorted the crimes into " << rings.size() << " rings in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+             << " ms\n";
+        ofstream ringsOut (RINGS_OUT);
+        rings.write(ringsOut, restauraunts);
+    }
+    // and the series only go over the links again
+    if(seriesGiven){
+        size_t leftOut = crimes.scoreSeries(series);
+        cout << "Counted the crimes over " << series.size() << " periods\n";
+        if(leftOut > 0)
+            cout << leftOut << " crimes dated after today were left out of the series\n";
+        ofstream seriesOut (SERIES_OUT);
+        series.write(seriesOut, restauraunts);
+    }
+    // This section outputs the food CSV nice and succinctly, in the same order as
+    // the licenses file
     ofstream foodOut (FOOD_OUT);
     foodOut << "Location, Name, Date, Address, Description, CrimeCost, Crimes\n";
-    quad.mapNodes(writeRestauraunt, &foodOut);
-    
-    for(struct Crime* crime : crimes){
-        delete crime;
+    for(Restauraunt* r : restauraunts)
+        r->write(foodOut, crimes.table, crimes.links);
+    if(snapshot.layers.size() > 0){
+        cout << snapshot.layers.links.links() << " links between places and crimes\n";
+        snapshot.layers.write(LAYER_OUT);
     }
     
-    delete addresses;
-    
-    // I should free all of the restauraunts in the quad, but this doesn't seem
-    // to work and I don't really care that much for a one-off script:
-    // quad.mapNodes(deleteRestauraunt, NULL);
-    
+    // Everything the crime pass worked out is saved, whether or not this run was -u, so
+    // that the next -u run carries on from this one
+    CrimeState state;
+    crimes.save(state, CRIME_FILE);
+    if(!state.save(STATE_FILE))
+        cerr << "Could not save the state to " << STATE_FILE << endl;
+    if(mapFile && !MappedSnapshot::write(mapFile, snapshot))
+        cerr << "Could not save the snapshot to " << mapFile << endl;
 }
\ No newline at end of file
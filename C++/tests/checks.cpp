@@ -0,0 +1,460 @@
+/******************************************************************************
+ * checks.cpp                                                                 *
+ *                                                                            *
+ * Small checks of the parts of the analysis that are easy to get quietly     *
+ * wrong (the scoring above all), each run on a little fixture built in       *
+ * memory rather than on the city's files, so they take no time at all. Each *
+ * failed check is printed, and the program exits with 1 if any did.          *
+ *                                                                            *
+ * Compile (from this directory) and run with                                 *
+ *       g++ -g -std=c++11 -I.. -o checks checks.cpp ../[A-Z]*.cpp -lz        *
+ *           -pthread && ./checks                                             *
+ * (every .cpp but analysis.cpp, which has the analysis's own main).          *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "CostSweep.h"
+#include "Crime.h"
+#include "CrimeIngest.h"
+#include "CrimeState.h"
+#include "CrimeTable.h"
+#include "Date.h"
+#include "Field.h"
+#include "IncidentSet.h"
+#include "Indexes.h"
+#include "Layers.h"
+#include "QuadTree.hpp"
+#include "TimeSeries.h"
+
+using namespace std;
+
+static int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+static void check(bool ok, const char* what, int line){
+    if(!ok){
+        cerr << "checks.cpp:" << line << ": failed: " << what << endl;
+        failures++;
+    }
+}
+
+// One restauraunt, opened 1000 days ago, with an unarmed crime 30 days ago and another
+// 400 days ago, each with an initial cost of 1 (and, if undated, a third crime with no
+// date, which should be left out)
+struct ScoringFixture{
+    ScoringFixture(bool undated = false) : index(makeIndex("kd")) {
+        today = Date::now().epochDay();
+        restauraunt.date = Date::fromEpochDay(today - 1000);
+        restauraunt.id = 0;
+        restauraunts.push_back(&restauraunt);
+        type = types.id("Larceny");
+        costs.update(types);
+        crimes = new CrimeIngest(*index, restauraunts, types, costs, 1);
+        addCrime(today - 30);
+        addCrime(today - 400);
+        if(undated)
+            addCrime(INVALID_DAY);
+        crimes->links.build(hits, restauraunts.size(), crimes->table);
+    }
+   ~ScoringFixture(){
+        delete crimes;
+        delete index;
+    }
+
+    void addCrime(int day){
+        CrimeHit hit;
+        hit.crime = crimes->table.add(Location(0, 0), Location(0, 0), Date::fromEpochDay(day),
+                                      type, 0, (unsigned)hits.size(), hits.size() + 1);
+        hit.restauraunt = 0;
+        hits.push_back(hit);
+    }
+
+    // the restauraunt's crime cost under decay
+    int score(DecayKind decay){
+        costs.decay = decay;
+        restauraunt.crimeCost = 0;
+        crimes->score();
+        return restauraunt.crimeCost;
+    }
+
+    SpatialIndex<Restauraunt>* index;
+    Restauraunt restauraunt;
+    vector<Restauraunt*> restauraunts;
+    TypeDictionary types;
+    CostModel costs;
+    CrimeIngest* crimes;
+    vector<CrimeHit> hits;
+    unsigned char type;
+    int today;
+};
+
+// Every crime decays to less than its initial cost under half life decay, so adding
+// each up rounded would give 0: 2^(-30/365) + 2^(-400/365) is 1.41. Recency gives
+// 1*(2/(1 + 30/50) + 1) + 1*(2/(1 + 400/50) + 1), or 3.47
+static void checkDecay(){
+    ScoringFixture fixture;
+    CHECK(fixture.score(DECAY_NONE) == 2);
+    CHECK(fixture.score(DECAY_RECENCY) == 3);
+    CHECK(fixture.score(DECAY_HALF_LIFE) == 1);
+}
+
+// A sweep of one set per decay policy should score exactly as a run of each does
+// (undated crimes and all). The sets are given in the order they are laid out in
+// (recency, half life, none), so the scores come out in the same order
+static void checkSweep(){
+    ScoringFixture fixture(true);
+    const char* path = "checks_sweep.cfg";
+    ofstream(path) << "set recency\ndecay recency\n"
+                   << "set halflife\ndecay halflife\n"
+                   << "set none\ndecay none\n";
+    CostSweep sweep;
+    CHECK(sweep.load(path, fixture.costs));
+    remove(path);
+    CHECK(sweep.size() == 3);
+    if(sweep.size() != 3)
+        return;
+    sweep.update(fixture.types);
+    vector<double> scores;
+    fixture.crimes->sweep(sweep, scores);
+    CHECK(llround(scores[0]) == fixture.score(DECAY_RECENCY));
+    CHECK(llround(scores[1]) == fixture.score(DECAY_HALF_LIFE));
+    CHECK(llround(scores[2]) == fixture.score(DECAY_NONE));
+}
+
+// A crime dated after today counts as if it happened today, rather than for less than
+// nothing (or, 50 days on, for infinitely much) under recency: 3.47 + 1*(2/1 + 1) under
+// recency, 1.41 + 1 under half life, and 3 crimes under none. The sweep agrees
+static void checkFutureCrimes(){
+    for(int ahead : {1, 50, 60}){
+        ScoringFixture fixture;
+        fixture.addCrime(fixture.today + ahead);
+        fixture.crimes->links.build(fixture.hits, 1, fixture.crimes->table);
+        CHECK(fixture.score(DECAY_RECENCY) == 6);
+        CHECK(fixture.score(DECAY_HALF_LIFE) == 2);
+        CHECK(fixture.score(DECAY_NONE) == 3);
+
+        const char* path = "checks_future.cfg";
+        ofstream(path) << "set recency\ndecay recency\nset halflife\ndecay halflife\n";
+        CostSweep sweep;
+        CHECK(sweep.load(path, fixture.costs));
+        remove(path);
+        if(sweep.size() != 2)
+            continue;
+        sweep.update(fixture.types);
+        vector<double> scores;
+        fixture.crimes->sweep(sweep, scores);
+        CHECK(llround(scores[0]) == 6 && llround(scores[1]) == 2);
+    }
+}
+
+// Dates that can't be read are INVALID_DAY, rather than some day in the year -1
+static bool readsAs(const char* text, int month, int day, int year){
+    Field f(text, text + strlen(text));
+    Date date;
+    date.setDate(f);
+    return date.valid() && date.epochDay() == Date(month, day, year).epochDay();
+}
+
+static bool invalid(const char* text){
+    Field f(text, text + strlen(text));
+    Date date;
+    date.setDate(f);
+    return !date.valid() && date.epochDay() == INVALID_DAY;
+}
+
+static void checkDates(){
+    CHECK(readsAs("01/05/2015 12:00:00 AM", 1, 5, 2015));
+    CHECK(readsAs("1/5/2015", 1, 5, 2015));
+    CHECK(Date(1, 1, 1970).epochDay() == 0);
+    CHECK(invalid(""));
+    CHECK(invalid("not a date"));
+    CHECK(invalid("13/01/2015"));
+    CHECK(invalid("00/00/0000"));
+    CHECK(invalid("1/5"));
+    CHECK(readsAs("12/31/9999", 12, 31, 9999));
+    CHECK(invalid("1/1/10000"));
+    CHECK(invalid("1/1/999999999"));
+    CHECK(invalid("1/1/99999999999"));
+    ostringstream out;
+    out << Date::fromEpochDay(INVALID_DAY);
+    CHECK(out.str().empty());
+
+    // and crimes with no date count for nothing, under every policy
+    ScoringFixture dated, undated(true);
+    CHECK(undated.score(DECAY_NONE) == dated.score(DECAY_NONE));
+    CHECK(undated.score(DECAY_RECENCY) == dated.score(DECAY_RECENCY));
+    CHECK(undated.score(DECAY_HALF_LIFE) == dated.score(DECAY_HALF_LIFE));
+}
+
+static unsigned long long keyOf(const char* compnos){
+    return IncidentSet::keyOf(Field(compnos, compnos + strlen(compnos)));
+}
+
+// Every COMPNOS but an empty one is an incident, and only the same text is the same
+// incident: "0" isn't an empty slot, and "0123" isn't 123
+static void checkIncidents(){
+    CHECK(keyOf("") == NO_INCIDENT);
+    CHECK(keyOf("0") != NO_INCIDENT);
+    CHECK(keyOf("0") != keyOf("000"));
+    CHECK(keyOf("0123") != keyOf("123"));
+    CHECK(keyOf("123") == 123);
+    CHECK(keyOf("I152071596") == keyOf("I152071596"));
+    IncidentSet set;
+    const char* compnos[] = {"0", "000", "0123", "123", "I152071596"};
+    for(unsigned i=0;i<5;i++)
+        CHECK(set.insert(keyOf(compnos[i]), i) == i);
+    for(unsigned i=0;i<5;i++){
+        unsigned crime = 99;
+        CHECK(set.insert(keyOf(compnos[i]), 10 + i) == i);
+        CHECK(set.find(keyOf(compnos[i]), crime) && crime == i);
+    }
+    CHECK(set.size() == 5);
+    // crimes without a COMPNOS are never merged
+    CHECK(set.insert(keyOf(""), 7) == 7 && set.insert(keyOf(""), 8) == 8);
+    // and everything is still there once the table has grown
+    for(unsigned i=0;i<5000;i++)
+        set.insert(i + 1000, i);
+    unsigned crime = 99;
+    CHECK(set.find(keyOf("0"), crime) && crime == 0);
+    CHECK(set.find(keyOf("0123"), crime) && crime == 2);
+}
+
+// The series runs from the month of the crime 400 days ago to this one, leaving out the
+// undated crime and one dated after today, and any range of dates only counts the
+// months it has in common with the series
+static void checkSeries(){
+    ScoringFixture fixture(true);
+    int today = fixture.today;
+    fixture.addCrime(today + 60);
+    fixture.crimes->links.build(fixture.hits, 1, fixture.crimes->table);
+    TimeSeries series;
+    CHECK(fixture.crimes->scoreSeries(series) == 1);
+    CHECK(series.first() == series.periodOf(today - 400));
+    CHECK(series.first() + (int)series.size() - 1 == series.periodOf(today));
+    CHECK(series.count(0, today - 400, today) == 2 && series.cost(0, today - 400, today) == 2);
+    CHECK(series.count(0, today - 30, today) == 1 && series.cost(0, today - 30, today) == 1);
+    CHECK(series.count(0, today - 5000, today + 5000) == 2);
+    // ranges that miss the series altogether, or run backwards, have nothing in them
+    CHECK(series.count(0, today - 2000, today - 1500) == 0);
+    CHECK(series.cost(0, today - 2000, today - 1500) == 0);
+    CHECK(series.count(0, today + 100, today + 200) == 0);
+    CHECK(series.cost(0, today + 100, today + 200) == 0);
+    CHECK(series.count(0, today, today - 400) == 0);
+    CHECK(series.count(0, INVALID_DAY, today) == 0);
+    // and periods outside it can't be added to
+    CHECK(!series.add(0, series.periodOf(today - 2000), 1));
+    CHECK(!series.add(0, series.periodOf(today + 100), 1));
+    CHECK(series.add(0, series.first(), 1));
+}
+
+// The distances from l to each of points, nearest first, for a brute force scan to
+// check the tree's answers against (distances rather than objects, so ties can come out
+// in either order)
+static vector<double> distancesFrom(Location l, const vector<Location>& points,
+                                    const vector<bool>& gone){
+    vector<double> distances;
+    for(size_t i=0;i<points.size();i++)
+        if(!gone[i])
+            distances.push_back(l.distSquared(points[i]));
+    sort(distances.begin(), distances.end());
+    return distances;
+}
+
+static vector<double> distancesOf(Location l, const vector<Restauraunt*>& found,
+                                  const vector<Location>& points){
+    vector<double> distances;
+    for(Restauraunt* r : found)
+        distances.push_back(l.distSquared(points[r->id]));
+    return distances;
+}
+
+// QuadTree::nearest() and remove() against a brute force scan of the same points: a
+// scatter of them, some on top of each other, inserted in a sorted order to make the
+// tree deep and lopsided, then a third taken back out again
+static void checkQuadTree(){
+    const size_t n = 600;
+    vector<Restauraunt> restauraunts(n);
+    vector<Location> points;
+    vector<bool> gone(n, false);
+    QuadTree<Restauraunt> tree;
+    unsigned seed = 12345;
+    for(size_t i=0;i<n;i++){
+        seed = seed*1103515245 + 12345;
+        double x = (seed >> 8)%1000;
+        seed = seed*1103515245 + 12345;
+        double y = (seed >> 8)%1000;
+        // every tenth point lands on the one before it
+        points.push_back(i%10 == 9 ? points.back() : Location(x, y));
+        restauraunts[i].id = (int)i;
+    }
+    vector<size_t> order;
+    for(size_t i=0;i<n;i++)
+        order.push_back(i);
+    sort(order.begin(), order.end(), [&](size_t a, size_t b){ return points[a].x < points[b].x; });
+    for(size_t i : order)
+        tree.insert(points[i], &restauraunts[i]);
+    Location queries[] = {Location(0, 0), Location(500, 500), Location(1500, 200),
+                          Location(-300, 2000), points[17]};
+    for(const Location& l : queries)
+        for(size_t k : {(size_t)1, (size_t)7, (size_t)50, n + 10}){
+            vector<double> all = distancesFrom(l, points, gone);
+            all.resize(min(k, all.size()));
+            CHECK(distancesOf(l, tree.nearest(l, k), points) == all);
+        }
+    CHECK(tree.nearest(queries[0], 0).empty());
+
+    for(size_t i=0;i<n;i+=3){
+        CHECK(tree.remove(points[i], &restauraunts[i]));
+        gone[i] = true;
+    }
+    CHECK(!tree.remove(points[0], &restauraunts[0]));
+    size_t left = 0;
+    bool removedSeen = false;
+    tree.forEach([&](Restauraunt* r){
+        left++;
+        removedSeen = removedSeen || gone[r->id];
+    });
+    CHECK(left == n - (n + 2)/3 && !removedSeen);
+    for(const Location& l : queries)
+        for(size_t k : {(size_t)1, (size_t)7, (size_t)50, n}){
+            vector<double> all = distancesFrom(l, points, gone);
+            all.resize(min(k, all.size()));
+            CHECK(distancesOf(l, tree.nearest(l, k), points) == all);
+        }
+
+    // and everything can come out, leaving an empty tree
+    for(size_t i=0;i<n;i++)
+        if(!gone[i])
+            CHECK(tree.remove(points[i], &restauraunts[i]));
+    CHECK(tree.root == NULL && tree.nearest(queries[1], 5).empty());
+}
+
+// A layer's name becomes part of the name of its CSV, so a name that could point it
+// anywhere else (or at nothing) is turned away when the layer file is read
+static void checkLayerNames(){
+    const char* path = "checks_layers.cfg";
+    ofstream(path) << "bars bars.csv 0 1\n"
+                   << "../../etc/passwd x.csv 0 1\n"
+                   << "a/b x.csv 0 1\n"
+                   << ". x.csv 0 1\n"
+                   << "bus-stops_2 stops.csv 0 1 2\n";
+    Layers layers;
+    CHECK(layers.load(path));
+    remove(path);
+    CHECK(layers.size() == 2);
+    if(layers.size() != 2)
+        return;
+    CHECK(layers.name(0) == "bars");
+    CHECK(layers.name(1) == "bus-stops_2");
+}
+
+// A State.bin whose hits point past its crimes or restauraunts is turned away by load(),
+// rather than used to index them
+static void checkStateBounds(){
+    ScoringFixture fixture;
+    CrimeState state;
+    state.table = fixture.crimes->table;
+    state.keys.push_back("the restauraunt");
+    state.hits = fixture.hits;
+    const char* path = "checks_state.bin";
+    CrimeState loaded;
+    CHECK(state.save(path) && loaded.load(path) && loaded.hits.size() == 2);
+    CrimeHit good = state.hits[0];
+    CrimeHit bad[] = {{2, 0}, {0, 1}, {0, -1}};
+    for(const CrimeHit& hit : bad){
+        state.hits[0] = hit;
+        CHECK(state.save(path) && !loaded.load(path));
+    }
+    state.hits[0] = good;
+    CHECK(state.save(path) && loaded.load(path));
+    remove(path);
+}
+
+// Whether crime i passes the filter, worked out the plain way
+static bool passes(const CrimeTable& table, const CrimeFilter& f, size_t i){
+    if(table.days[i] < f.firstDay || table.days[i] > f.lastDay)
+        return false;
+    if(table.xs[i] < f.minX || table.xs[i] > f.maxX || table.ys[i] < f.minY || table.ys[i] > f.maxY)
+        return false;
+    if(f.type >= 0 && table.types[i] != f.type)
+        return false;
+    return (table.weapons[i] & f.weaponMask) == f.weaponValue;
+}
+
+// CrimeTable::select() and count() against a plain loop over the same table, under each
+// kind of filter on its own and all of them at once. The table runs a little past a few
+// whole blocks of the filter, and has some crimes with no date
+static void checkFilters(){
+    CrimeTable table;
+    unsigned seed = 777;
+    auto next = [&](unsigned n){
+        seed = seed*1103515245 + 12345;
+        return (seed >> 8)%n;
+    };
+    for(unsigned i=0;i<1000;i++){
+        Location metric(next(1000), next(1000));
+        Date date = Date::fromEpochDay(i%50 == 0 ? INVALID_DAY : 15000 + (int)next(1500));
+        table.add(metric, metric, date, (unsigned char)next(5), (unsigned char)next(WEAPON_KINDS),
+                  i, i);
+    }
+    vector<CrimeFilter> filters(7);
+    filters[1].type = 2;
+    filters[2].weaponMask = WEAPON_FLAG;
+    filters[2].weaponValue = 3;
+    filters[3].weaponMask = SHOOTING_FLAG;
+    filters[3].weaponValue = SHOOTING_FLAG;
+    filters[4].firstDay = 15500;
+    filters[4].lastDay = 15999;
+    filters[5].minX = 100;
+    filters[5].maxX = 400.5;
+    filters[5].minY = 250;
+    filters[5].maxY = 900;
+    filters[6] = filters[5];
+    filters[6].firstDay = 15000;
+    filters[6].lastDay = 16000;
+    filters[6].type = 4;
+    filters[6].weaponMask = WEAPON_FLAG | SHOOTING_FLAG;
+    filters[6].weaponValue = 0;
+    for(const CrimeFilter& f : filters){
+        vector<unsigned> expected, selected;
+        for(size_t i=0;i<table.size();i++)
+            if(passes(table, f, i))
+                expected.push_back((unsigned)i);
+        table.select(f, selected);
+        CHECK(selected == expected);
+        CHECK(table.count(f) == expected.size());
+        // (and every filter but the first, which passes everything, should let some
+        // through and keep some out, to mean anything)
+        CHECK(!expected.empty());
+        CHECK(&f == &filters[0] ? expected.size() == table.size() : expected.size() < table.size());
+    }
+    CHECK(CrimeTable().count(filters[6]) == 0);
+}
+
+int main(){
+    checkFilters();
+    checkDecay();
+    checkSweep();
+    checkFutureCrimes();
+    checkDates();
+    checkIncidents();
+    checkStateBounds();
+    checkSeries();
+    checkQuadTree();
+    checkLayerNames();
+    if(failures){
+        cerr << failures << " checks failed" << endl;
+        return 1;
+    }
+    cout << "All checks passed" << endl;
+    return 0;
+}
@@ -12,21 +12,58 @@
 # And now might be a good time to indicate what it actually does: this program #
 # reads the food licenses file, finds any restauraunts with unspecified        #
 # coordinates, and uses Google's Geocoding API to guess the coordinates from   #
-# the address, which does seem to be given 100% of the time. Then it outputs   #
-# this data in a JSON file with keys of addresses and values of locations      #
+# the address, which does seem to be given 100% of the time.                   #
+#                                                                              #
+# The locations found are kept in a geocode cache, OUT_FILE, which the C++     #
+# maps and looks addresses up in directly (see C++/GeoCache.h). Addresses are  #
+# normalized (upper case, with runs of spaces made one space) before they are  #
+# stored or looked up, and every address already in the cache is kept, so      #
+# only addresses new to this version of the licenses file are looked up with   #
+# Google. Addresses Google can't find aren't cached, so they are tried again   #
+# next time.                                                                   #
+#                                                                              #
+# The cache is a minimal perfect hash table: every address has a slot of its   #
+# own, found with at most two hashes and never a probe, so the table is        #
+# exactly as big as the number of addresses. Its layout (all little endian):   #
+#                                                                              #
+#   "GEOCACHE", version, number of addresses n, number of buckets b (uint32s)  #
+#   b int32 displacements, padded to 8 bytes                                   #
+#   n slots of (latitude, longitude as doubles, key offset, key length)        #
+#   the keys' characters                                                       #
+#                                                                              #
+# An address hashes (FNV-1a with a seed of 0) to a bucket. A displacement d    #
+# of 0 or more means the address's slot is its hash with a seed of d, mod n;   #
+# a negative one means the bucket's one address is in slot -d - 1.             #
+#                                                                              #
+# Run with                                                                     #
+#       python locationFinder.py            (looks up the new addresses)       #
+#       python locationFinder.py --convert  (just turns the old locs.json      #
+#                                             into a cache)                    #
 ################################################################################
 
-import requests, csv, time, config
+from __future__ import print_function
+
+import csv, json, os, struct, sys
 
 
 IN_FILE  = '../data/Active_Food_Establishment_Licenses.csv'
-OUT_FILE = '../data/locs.json'
+# the JSON file of addresses and locations this used to write, which --convert reads
+JSON_FILE = '../data/locs.json'
+OUT_FILE = '../data/locs.bin'
+
+MAGIC = b'GEOCACHE'
+VERSION = 1
+
+FNV_OFFSET = 14695981039346656037
+FNV_PRIME = 1099511628211
+MASK = (1 << 64) - 1
 
 # Uses Google's Geocaching API to get location from address
 # The limit to the API is 5 calls per second, so it is necessary to sleep 5
 # seconds between calls
 def getLocationFromAddress(address):
-    print 'parsingAddress:',address
+    import requests, time, config
+    print('parsingAddress:', address)
     url = 'https://maps.googleapis.com/maps/api/geocode/json'
     data = {'key':config.API_KEY, 'address':address}
     r = requests.get(url, params=data)
@@ -44,20 +81,129 @@ def getLocationFromAddress(address):
 def parseAddress(row):
     return  row['Address'] +' '+row['City']+', '+row['State'] + ', '+row['Zip']
 
-foodFile  = open(IN_FILE)
-
-foodReader = csv.DictReader(foodFile)
-i=0
-addresses={}
-for row in foodReader:
-    location = row['Location']
-    # A location is unset iff the 2nd character is a 0
-    if(location[1] == '0'):
-        address = parseAddress(row)
-        addresses[address] = getLocationFromAddress(address)
-    if(i%100 == 0):
-        print i,'restauraunts parsed'
-    i+=1
- 
-with open(OUT_FILE, 'w') as outfile:
-    json.dump(data, outfile)
\ No newline at end of file
+# Upper case, with no spaces at either end and runs of spaces in between made one
+# space, exactly as GeoCache.cpp does it
+def normalize(address):
+    if not isinstance(address, bytes):
+        address = address.encode('utf-8')
+    out = bytearray()
+    space = False
+    for c in bytearray(address):
+        if c in b' \t\n\v\f\r':
+            space = len(out) > 0
+            continue
+        if space:
+            out.append(ord(' '))
+            space = False
+        if ord('a') <= c <= ord('z'):
+            c -= 32
+        out.append(c)
+    return bytes(out)
+
+# FNV-1a, starting from the offset basis xored with seed
+def fnv(seed, key):
+    h = FNV_OFFSET ^ seed
+    for c in bytearray(key):
+        h = ((h ^ c) * FNV_PRIME) & MASK
+    return h
+
+# Reads the cache at path into a dict of normalized address -> (lat, lng)
+def readCache(path):
+    cache = {}
+    if not os.path.exists(path):
+        return cache
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic, version, n, b = struct.unpack_from('<8sIII', data, 0)
+    if magic != MAGIC or version != VERSION:
+        print(path, 'is not a geocode cache of version', VERSION, 'so starting afresh')
+        return cache
+    slots = (20 + 4*b + 7)//8*8
+    for i in range(n):
+        lat, lng, offset, length = struct.unpack_from('<ddII', data, slots + 24*i)
+        cache[data[offset:offset + length]] = (lat, lng)
+    return cache
+
+# Works out the displacements: the buckets with the most addresses are placed first,
+# each trying seeds until every one of its addresses lands in a free slot, and then
+# the buckets of one address just take the free slots that are left
+def buildTable(keys):
+    n = len(keys)
+    b = max(n, 1)
+    buckets = [[] for _ in range(b)]
+    for i, key in enumerate(keys):
+        buckets[fnv(0, key) % b].append(i)
+    order = sorted(range(b), key=lambda j: (-len(buckets[j]), j))
+    displacements = [0]*b
+    slots = [None]*n
+    for j in order:
+        bucket = buckets[j]
+        if len(bucket) <= 1:
+            break
+        d = 1
+        while True:
+            places = [fnv(d, keys[i]) % n for i in bucket]
+            if len(set(places)) == len(places) and all(slots[p] is None for p in places):
+                break
+            d += 1
+        displacements[j] = d
+        for i, p in zip(bucket, places):
+            slots[p] = i
+    free = [s for s in range(n) if slots[s] is None]
+    free.reverse()
+    for j in order:
+        if len(buckets[j]) == 1:
+            s = free.pop()
+            displacements[j] = -s - 1
+            slots[s] = buckets[j][0]
+    return displacements, slots
+
+def writeCache(path, cache):
+    keys = sorted(cache)
+    displacements, slots = buildTable(keys)
+    n, b = len(keys), len(displacements)
+    header = struct.pack('<8sIII', MAGIC, VERSION, n, b)
+    table = struct.pack('<%di' % b, *displacements)
+    start = len(header) + len(table)
+    padding = b'\0'*((start + 7)//8*8 - start)
+    chars = bytearray()
+    offset = (start + 7)//8*8 + 24*n
+    entries = bytearray()
+    for i in slots:
+        key = keys[i]
+        lat, lng = cache[key]
+        entries += struct.pack('<ddII', lat, lng, offset + len(chars), len(key))
+        chars += key
+    temporary = path + '.new'
+    with open(temporary, 'wb') as f:
+        f.write(header + table + padding + bytes(entries) + bytes(chars))
+    os.rename(temporary, path)
+
+cache = readCache(OUT_FILE)
+if '--convert' in sys.argv[1:]:
+    with open(JSON_FILE) as f:
+        locations = json.load(f)
+    for address in sorted(locations):
+        lat, lng = locations[address]
+        if (lat, lng) != (0, 0):
+            cache[normalize(address)] = (float(lat), float(lng))
+else:
+    foodFile  = open(IN_FILE)
+    foodReader = csv.DictReader(foodFile)
+    i=0
+    for row in foodReader:
+        location = row['Location']
+        # A location is unset iff the 2nd character is a 0
+        if(location[1] == '0'):
+            address = parseAddress(row)
+            key = normalize(address)
+            if key not in cache:
+                lat, lng = getLocationFromAddress(address)
+                if (lat, lng) != (0, 0):
+                    cache[key] = (float(lat), float(lng))
+        if(i%100 == 0):
+            print(i,'restauraunts parsed')
+        i+=1
+
+writeCache(OUT_FILE, cache)
+print(len(cache), 'addresses in', OUT_FILE)